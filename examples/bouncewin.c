@@ -36,15 +36,15 @@
 
 #include "winutils.h"
 
-static AXUIElementRef appWindow;
-
 /* Callback for EnumerateWindows() records the first window it encounters */
-void FindWindow(CFDictionaryRef window, void *ignored) {
+void FindWindow(CFDictionaryRef window, void *appWindowPtr) {
+    AXUIElementRef *appWindow = (AXUIElementRef *)appWindowPtr;
+
     /* If we already found a window, skip all subsequent ones */
-    if(appWindow) return;
+    if(*appWindow) return;
 
     /* Get AXUIElementRef handle to window */
-    appWindow = AXWindowFromCGWindow(window);
+    *appWindow = AXWindowFromCGWindow(window);
 }
 
 int main(int argc, char **argv) {
@@ -54,9 +54,10 @@ int main(int argc, char **argv) {
     CGRect displayBounds;
     int minX, minY, maxX, maxY, dX, dY;
     CGPoint position;
+    AXUIElementRef appWindow;
 
     /* Die if we are not authorized to use OS X accessibility */
-    if(!isAuthorized()) {
+    if(!isAuthorizedForAccessibility()) {
         fputs("bouncewin: not authorized to use accessibility API\n", stderr);
         return 1;
     }
@@ -64,7 +65,7 @@ int main(int argc, char **argv) {
     /* Try to find a window */
     if(argc > 1 && *argv[1]) pattern = argv[1];
     appWindow = NULL;
-    EnumerateWindows(pattern, FindWindow, (void *)appWindow);
+    EnumerateWindows(pattern, FindWindow, (void *)&appWindow);
 
     /* Return failure if we found no window */
     if(!appWindow) return 1;
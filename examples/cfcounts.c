@@ -0,0 +1,141 @@
+/* ========================================================================
+ * cfcounts.c - count CF ownership calls per window operation
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include "winfuzzy.h"
+#include "mockcarbon.h"
+#include "winclaim.h"
+#include "winshm.h"
+
+/* Built only in examples/mock, where every CF call is counted: objects
+ * the caller came to own through a Create or Copy call, CFRetain() calls,
+ * and CFRelease() calls. Each operation must release what it took.
+ */
+#define ME "cfcounts"
+#define APPS 6
+#define WINDOWS 48
+
+int movewin_main(int argc, char **argv);
+
+/* Callback for EnumerateWindows() that does nothing with the window */
+static void ignoreWindow(CFDictionaryRef window, void *unused) {
+}
+
+/* Callback that resolves each window to its accessibility object */
+static void resolveWindow(CFDictionaryRef window, void *unused) {
+    AXUIElementRef appWindow = AXWindowFromCGWindow(window);
+    if(appWindow) CFRelease(appWindow);
+}
+
+static void enumerate() {
+    EnumerateWindows(NULL, ignoreWindow, NULL);
+}
+
+static void enumerateFuzzy() {
+    EnumerateWindowsFuzzy("win", 0, ignoreWindow, NULL);
+}
+
+static void resolve() {
+    EnumerateWindows(NULL, resolveWindow, NULL);
+}
+
+/* Run movewin -a over every window, back and forth between two places */
+static void moveAll() {
+    static int flip;
+    char *argv[] = {
+        "movewin", "-a", "-o", "0,0", "Window", NULL, "60", NULL
+    };
+    argv[5] = (flip = !flip) ? "40" : "80";
+    optind = 1;
+    movewin_main(sizeof(argv) / sizeof(argv[0]) - 1, argv);
+}
+
+/* Run operation, print what it did to CF ownership, return true if it
+ * kept or over-released anything
+ */
+static int count(const char *label, void(*operation)()) {
+    MockCarbonCounts counts;
+    long live = MockCarbonLiveObjects();
+
+    MockCarbonResetCounts();
+    operation();
+    MockCarbonGetCounts(&counts);
+    printf(
+        "%-16s %5ld owned %5ld retained %5ld released %5ld live\n",
+        label, counts.owned, counts.retained, counts.released,
+        MockCarbonLiveObjects() - live
+    );
+
+    return counts.owned + counts.retained != counts.released ||
+        MockCarbonLiveObjects() != live;
+}
+
+int main(int argc, char **argv) {
+    char dir[] = "/tmp/cfcountsXXXXXX", path[64], claims[64];
+    int failed = 0;
+
+    /* Keep the journal, claim table, and authorization cache out of the
+     * user's way
+     */
+    if(!mkdtemp(dir)) {
+        perror(ME ": mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/journal", dir);
+    setenv("MOVEWIN_JOURNAL", path, 1);
+    setenv("TMPDIR", dir, 1);
+    snprintf(claims, sizeof(claims), "/cfcounts.%d", (int)getpid());
+    setenv(WINCLAIM_ENV, claims, 1);
+
+    printf("%d windows of %d applications\n", WINDOWS, APPS);
+    MockCarbonMakeWindows(WINDOWS, APPS);
+    failed |= count("enumerate", enumerate);
+    failed |= count("enumerate fuzzy", enumerateFuzzy);
+    failed |= count("resolve each", resolve);
+    failed |= count("movewin -a", moveAll);
+    if(failed) fprintf(stderr, ME ": CF references left unbalanced\n");
+
+    WinShmUnlink(claims);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/movewin-auth-%u", dir,
+             (unsigned int)getuid());
+    unlink(path);
+    rmdir(dir);
+
+    return failed;
+}
+
+
+/* ======================================================================== */
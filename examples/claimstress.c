@@ -0,0 +1,228 @@
+/* ========================================================================
+ * claimstress.c - race many processes to move the same few windows
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "winshm.h"
+#include "winclaim.h"
+
+#define ME "claimstress"
+#define CLAIMS_NAME "/movewin.claimstress"
+#define PROCESSES 8
+#define ROUNDS 20000
+#define WINDOWS 4
+#define WINDOW_STRIDE 256     /* IDs this far apart share a first slot */
+
+/* A move that went ahead, with the newest claim on its window that had
+ * been taken, as far as anyone could see, when it checked its own
+ */
+typedef struct {
+    uint32_t window;
+    uint32_t ticket;
+    uint32_t newestSeen;
+} StressWrite;
+
+/* Shared by all processes */
+typedef struct {
+    atomic_uint newest[WINDOWS];     /* newest ticket taken on each window */
+    atomic_long writes;              /* moves that went ahead */
+    atomic_long skipped;             /* moves skipped as superseded */
+    StressWrite log[PROCESSES * ROUNDS];
+} StressCounts;
+
+/* Return true if ticket a was issued after ticket b, as winclaim.c does */
+static int isNewer(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+/* Record that ticket was taken on window w, keeping only the newest */
+static void publishTicket(StressCounts *counts, int w, uint32_t ticket) {
+    uint32_t newest = atomic_load(&counts->newest[w]);
+    while(isNewer(ticket, newest) &&
+          !atomic_compare_exchange_weak(&counts->newest[w], &newest, ticket));
+}
+
+/* Each process repeatedly claims a window, pretends to fetch its
+ * accessibility object, then writes only if nobody claimed it since.
+ * Window IDs all hash to the same slot, so claims probe past each other.
+ */
+static void race(WinClaimTable *table, StressCounts *counts, int seed) {
+    CGWindowID windowId;
+    uint32_t ticket, newestSeen;
+    long n;
+    int i, w;
+
+    srandom(seed);
+    for(i = 0; i < ROUNDS; i++) {
+        w = random() % WINDOWS;
+        windowId = 1 + w * WINDOW_STRIDE;
+        ticket = WinClaimTake(table, windowId);
+        publishTicket(counts, w, ticket);
+        if(random() % 4 == 0) usleep(1);
+        newestSeen = atomic_load(&counts->newest[w]);
+        if(WinClaimIsSuperseded(table, windowId, ticket)) {
+            atomic_fetch_add(&counts->skipped, 1);
+        } else {
+            n = atomic_fetch_add(&counts->writes, 1);
+            counts->log[n].window = windowId;
+            counts->log[n].ticket = ticket;
+            counts->log[n].newestSeen = newestSeen;
+        }
+    }
+}
+
+/* Return slot holding the claim on windowId (-1 if none), and how many */
+static int findSlot(WinClaimTable *table, CGWindowID windowId, int *count) {
+    int i, found = -1;
+
+    for(*count = i = 0; i < WINCLAIM_SLOTS; i++) {
+        if((CGWindowID)(atomic_load(&table->slots[i].claim) >> 32) ==
+           windowId)
+        {
+            if(found == -1) found = i;
+            (*count)++;
+        }
+    }
+
+    return found;
+}
+
+/* Claim a window whose slot lies past one with an expired lease: the claim
+ * must go to the window's own slot rather than a second one, and must
+ * supersede the window's earlier claim even once that expired slot is
+ * taken over by yet another window. Uses IDs that share a first slot with
+ * each other but not with those race() claims.
+ */
+static int checkExpiredSlots(WinClaimTable *table) {
+    CGWindowID first = 2, window = 2 + 2 * WINDOW_STRIDE;
+    uint32_t oldTicket, newTicket;
+    int slot, count, failed = 0;
+
+    WinClaimTake(table, first);
+    WinClaimTake(table, 2 + WINDOW_STRIDE);
+    oldTicket = WinClaimTake(table, window);
+    atomic_store(&table->slots[findSlot(table, first, &count)].expires, 0);
+
+    newTicket = WinClaimTake(table, window);
+    slot = findSlot(table, window, &count);
+    if(count != 1) {
+        fprintf(stderr, ME ": window %u claimed in %d slots after its "
+                "chain had an expired slot\n", window, count);
+        failed = 1;
+    }
+
+    /* Let the window's slot expire too, and have another window take it */
+    if(slot != -1) atomic_store(&table->slots[slot].expires, 0);
+    slot = findSlot(table, first, &count);
+    if(slot != -1) atomic_store(&table->slots[slot].expires, 0);
+    WinClaimTake(table, 2 + 3 * WINDOW_STRIDE);
+    if(!WinClaimIsSuperseded(table, window, oldTicket) ||
+       WinClaimIsSuperseded(table, window, newTicket))
+    {
+        fprintf(stderr, ME ": claim %u on window %u not the newest after "
+                "expired slots were taken over\n", newTicket, window);
+        failed = 1;
+    }
+    atomic_store(&table->superseded, 0);
+
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    WinClaimTable *table;
+    StressCounts *counts;
+    pid_t pids[PROCESSES];
+    long writes, stale = 0, n;
+    int i, status, failed = 0;
+
+    WinShmUnlink(CLAIMS_NAME);
+    table = WinClaimOpen(CLAIMS_NAME);
+    if(!table) {
+        fprintf(stderr, ME ": unable to open claim table\n");
+        return 1;
+    }
+    failed = checkExpiredSlots(table);
+    counts = (StressCounts *)mmap(
+        NULL, sizeof(StressCounts), PROT_READ|PROT_WRITE,
+        MAP_SHARED|MAP_ANON, -1, 0
+    );
+    for(i = 0; i < WINDOWS; i++) atomic_init(&counts->newest[i], 0);
+    atomic_init(&counts->writes, 0);
+    atomic_init(&counts->skipped, 0);
+
+    for(i = 0; i < PROCESSES; i++) {
+        if((pids[i] = fork()) == 0) {
+            race(table, counts, i + 1);
+            _exit(0);
+        }
+    }
+    for(i = 0; i < PROCESSES; i++) {
+        waitpid(pids[i], &status, 0);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+    }
+
+    /* No write may go ahead once a newer claim on its window was taken */
+    writes = atomic_load(&counts->writes);
+    for(n = 0; n < writes; n++) {
+        if(isNewer(counts->log[n].newestSeen, counts->log[n].ticket)) {
+            if(stale++ < 10) {
+                fprintf(
+                    stderr, ME ": window %u written with ticket %u after "
+                    "ticket %u was taken\n", counts->log[n].window,
+                    counts->log[n].ticket, counts->log[n].newestSeen
+                );
+            }
+            failed = 1;
+        }
+    }
+
+    printf(
+        "%d processes x %d moves on %d windows: %ld written, "
+        "%ld redundant writes avoided (%u counted by table), "
+        "%ld written over a newer claim\n",
+        PROCESSES, ROUNDS, WINDOWS, writes, atomic_load(&counts->skipped),
+        atomic_load(&table->superseded), stale
+    );
+
+    WinClaimClose(table);
+    munmap((void *)counts, sizeof(StressCounts));
+    WinShmUnlink(CLAIMS_NAME);
+
+    return failed;
+}
+
+
+/* ======================================================================== */
@@ -1,5 +1,5 @@
 /* ========================================================================
- * findleaks.c - run winutils functions in a loop to help find memory leaks
+ * findleaks.c - run winutils functions in a loop and fail if memory grows
  * Andrew Ho (andrew@zeuscat.com)
  *
  * Copyright (c) 2014-2020, Andrew Ho.
@@ -35,64 +35,160 @@
  */
 
 #include "winutils.h"
+#ifdef MOCK_CARBON
+#include "mockcarbon.h"
+#else
+#include <malloc/malloc.h>
+#endif
+
 #define ME "findleaks"
+#define USAGE "usage: " ME " [-h] [-n cycles] [-w warmup] [-s slack] [title]\n"
+#define FULL_USAGE USAGE \
+    "    -h         display this help text and exit\n" \
+    "    -n cycles  enumerate+resolve cycles to measure (default 4096)\n" \
+    "    -w warmup  cycles to run before taking the baseline (default 64)\n" \
+    "    -s slack   live allocations allowed to grow (default 256)\n" \
+    "    title      pattern to match \"Application - Title\" against\n"
+
+/* Counts of what one run of the harness has exercised */
+typedef struct {
+    long windows;        /* windows visited by TestWindow() */
+    long resolved;       /* windows resolved to accessibility objects */
+} FindLeaksCtx;
 
 /* Callback for EnumerateWindows() that exercises various functions */
-void TestWindow(CFDictionaryRef window, void *unused) {
+void TestWindow(CFDictionaryRef window, void *ctxPtr) {
+    FindLeaksCtx *ctx = (FindLeaksCtx *)ctxPtr;
     char *appName = CFDictionaryCopyCString(window, kCGWindowOwnerName);
     char *windowName = CFDictionaryCopyCString(window, kCGWindowName);
-    CGPoint position = CGWindowGetPosition(window);
-    CGSize size = CGWindowGetSize(window);
-    size_t throwaway;
-    AXUIElementRef appWindow = NULL;
+    char *title = windowTitle(appName, windowName);
+    AXUIElementRef appWindow = AXWindowFromCGWindow(window);
+
+    /* Read back position and size through both APIs */
+    CGWindowGetPosition(window);
+    CGWindowGetSize(window);
+    if(appWindow) {
+        AXWindowGetPosition(appWindow);
+        AXWindowGetSize(appWindow);
+        CFRelease(appWindow);
+        ctx->resolved++;
+    }
+    ctx->windows++;
 
-    /* Reference values to silence -Wall "unused variable" warnings */
-    throwaway = strlen(appName);
-    throwaway = strlen(windowName);
-    throwaway = (size_t)position.x;
-    throwaway = (size_t)size.width;
+    free(title);
+    if(windowName) free(windowName);
+    if(appName) free(appName);
+}
 
-    appWindow = AXWindowFromCGWindow(window);
+#ifdef MOCK_CARBON
+/* Return number of live heap allocations, counted by examples/mock */
+static size_t liveAllocations() {
+    return MockAllocLiveBlocks();
+}
 
-    free(windowName);
-    free(appName);
+/* Return CF references the process holds, by the calls it has made:
+ * one for each object it created or copied, and for each CFRetain(),
+ * less one for each CFRelease()
+ */
+static long cfReferences() {
+    MockCarbonCounts counts;
+    MockCarbonGetCounts(&counts);
+    return counts.owned + counts.retained - counts.released;
+}
+#else
+/* Return number of live heap allocations across all malloc zones */
+static size_t liveAllocations() {
+    malloc_statistics_t stats;
+    malloc_zone_statistics(NULL, &stats);
+    return stats.blocks_in_use;
+}
+
+/* CF calls cannot be counted against the real frameworks */
+static long cfReferences() {
+    return 0;
 }
+#endif
 
 int main(int argc, char **argv) {
-    int i, j;
-
-#define DELAY_MICROSEC 1
-#define RUNS 1024
-#define TICKS 60
-#define SHOW_EVERY ((int)((RUNS) / (TICKS)))
-#define SHOW_MEMORY() \
-system("/bin/ps auxw | grep '" ME "$' | grep -v grep | awk '{ print $5, $6 }'")
-
-    SHOW_MEMORY();
-    for(i = 0; i < RUNS; i++) {
-        EnumerateWindows(NULL, TestWindow, NULL);
-        if(i == 0) {
-            SHOW_MEMORY();
-            fprintf(stderr, "%d runs, %d runs/tick\n", RUNS, SHOW_EVERY);
-            fputs("Progress: [", stderr);
-            for(j = 0; j < RUNS; j++) {
-                if(j % SHOW_EVERY == 0) fputc('-', stderr);
-            }
-            fputs("]\rProgress: [", stderr);
+    FindLeaksCtx ctx;
+    int ch, i, cycles = 4096, warmup = 64, slack = 256;
+    size_t baseline, peak, live;
+    long references, cfGrowth = 0, cfCycles = 0;
+    char *pattern = NULL;
+
+#define DIE_OPT(msg) \
+    { fprintf(stderr, ME ": " msg " -- %c\n" USAGE, optopt); return 2; }
+
+    while((ch = getopt(argc, argv, ":hn:w:s:")) != -1) {
+        switch(ch) {
+            case 'h':
+                printf(FULL_USAGE);
+                return 0;
+            case 'n':
+                cycles = atoi(optarg);
+                break;
+            case 'w':
+                warmup = atoi(optarg);
+                break;
+            case 's':
+                slack = atoi(optarg);
+                break;
+            case ':':
+                DIE_OPT("option requires an argument");
+            default:
+                DIE_OPT("illegal option");
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if(argc > 0) pattern = argv[0];
+
+    /* Let frameworks settle their caches before taking a baseline */
+    memset(&ctx, 0, sizeof(ctx));
+    for(i = 0; i < warmup; i++) EnumerateWindows(pattern, TestWindow, &ctx);
+    baseline = peak = liveAllocations();
+
+    /* Every cycle must give back each CF reference it takes */
+    memset(&ctx, 0, sizeof(ctx));
+    for(i = 0; i < cycles; i++) {
+        references = cfReferences();
+        EnumerateWindows(pattern, TestWindow, &ctx);
+        if(cfReferences() != references) {
+            cfGrowth += cfReferences() - references;
+            cfCycles++;
         }
-        if(i % SHOW_EVERY == 0) fputc('*', stderr);
-        usleep(DELAY_MICROSEC);
+        live = liveAllocations();
+        if(live > peak) peak = live;
     }
-    fputs("]\n", stderr);
-    SHOW_MEMORY();
+    live = liveAllocations();
 
-#undef SHOW_MEMORY
-#undef SHOW_EVERY
-#undef TICKS
-#undef RUNS
-#undef DELAY
+    fprintf(
+        stderr,
+        "%d cycles, %ld windows, %ld resolved, "
+        "live allocations %zu -> %zu (peak %zu)\n",
+        cycles, ctx.windows, ctx.resolved, baseline, live, peak
+    );
+
+    /* Fail if any cycle kept or over-released a CF object */
+    if(cfCycles > 0) {
+        fprintf(
+            stderr, ME ": %ld cycles left CF references off by %ld in all\n",
+            cfCycles, cfGrowth
+        );
+        return 1;
+    }
+
+    /* Fail if live allocations grew by more than the allowed slack */
+    if(live > baseline + slack) {
+        fprintf(
+            stderr, ME ": live allocations grew by %zu\n", live - baseline
+        );
+        return 1;
+    }
 
     return 0;
+
+#undef DIE_OPT
 }
 
 
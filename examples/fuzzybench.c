@@ -0,0 +1,236 @@
+/* ========================================================================
+ * fuzzybench.c - time fuzzy scoring over many synthetic window titles
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sys/time.h>
+#include "winfuzzy.h"
+#ifdef MOCK_CARBON
+#include "mockcarbon.h"
+#endif
+
+/* Built twice by both examples/Makefile and examples/mock/Makefile:
+ * fuzzybench uses the vector scan in winfuzzy.c, fuzzybench-scalar is
+ * compiled with -DWINFUZZY_SCALAR, and apart from timings the two must
+ * print the same. Add -mavx2 to CC_FLAGS to try the AVX2 path on Intel
+ * machines. Against the mock, the whole -z path (listing, scoring, and
+ * picking the best TOP_K) is timed over the same titles as windows; on
+ * macOS, over whatever windows are open.
+ */
+#define TITLES 100000
+#define ROUNDS 10
+#define LIST_ROUNDS 3
+#define TOP_K 10
+#define LONG_TITLE_MIN 64         /* bytes, past one AVX2 block */
+
+static const char *apps[] = {
+    "iTerm2", "Firefox", "Google Chrome", "Finder", "Slack", "Xcode",
+    "Visual Studio Code", "Terminal", "Mail", "Calendar", "Preview"
+};
+static const char *words[] = {
+    "Default", "Downloads", "README.md", "movewin", "pull request",
+    "Inbox", "build log", "winutils.c", "design review", "untitled",
+    "localhost:8080", "Quarterly Planning", "bash", "zsh", "notes"
+};
+static const char *queries[] = {
+    "term", "fxrd", "chrpl", "mwin", "xyzzy", "fz"
+};
+
+/* Return current time in seconds */
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Fill buf with a repeatable "App - word word word" title, or with long
+ * set, one of at least LONG_TITLE_MIN bytes with long gaps between words
+ */
+static void makeTitle(char *buf, size_t size, int isLong) {
+    int nApps = sizeof(apps) / sizeof(apps[0]);
+    int nWords = sizeof(words) / sizeof(words[0]);
+    size_t len;
+
+    len = snprintf(
+        buf, size, "%s - %s %s %s", apps[random() % nApps],
+        words[random() % nWords], words[random() % nWords],
+        words[random() % nWords]
+    );
+    while(isLong && len < LONG_TITLE_MIN + (size_t)(random() % 64)) {
+        len += snprintf(
+            buf + len, size - len, " %s", words[random() % nWords]
+        );
+    }
+}
+
+/* Score every title against every query, and print how long it took */
+static void bench(const char *label, char **titles, size_t *lengths) {
+    int i, j, q, score, matches;
+    long checksum;
+    double start, elapsed;
+
+    for(q = 0; q < (int)(sizeof(queries) / sizeof(queries[0])); q++) {
+        matches = 0;
+        checksum = 0;
+        start = now();
+        for(j = 0; j < ROUNDS; j++) {
+            for(i = 0; i < TITLES; i++) {
+                score = FuzzyScore(queries[q], titles[i], lengths[i]);
+                if(score != FUZZY_NO_MATCH) {
+                    matches++;
+                    checksum += score;
+                }
+            }
+        }
+        elapsed = now() - start;
+        printf(
+            "%-5s %-6s %d titles x %d: %.1f ns/title, %d matches, "
+            "checksum %ld\n",
+            label, queries[q], TITLES, ROUNDS,
+            elapsed * 1e9 / (TITLES * ROUNDS), matches / ROUNDS,
+            checksum / ROUNDS
+        );
+    }
+}
+
+/* Callback for EnumerateWindowListFuzzy() folds window IDs, best first,
+ * into a checksum of which windows were picked and in what order
+ */
+static void addTopWindow(CFDictionaryRef window, void *checksumPtr) {
+    unsigned long *checksum = (unsigned long *)checksumPtr;
+    *checksum = *checksum * 31 + CFDictionaryGetInt(window, kCGWindowNumber);
+}
+
+/* Time the whole fuzzy search, best TOP_K of every window, per query */
+static void benchList(const char *label, CFArrayRef windowList) {
+    int j, q, matches;
+    unsigned long checksum;
+    CFIndex count = windowList ? CFArrayGetCount(windowList) : 0;
+    double start, elapsed;
+
+    for(q = 0; q < (int)(sizeof(queries) / sizeof(queries[0])); q++) {
+        start = now();
+        for(j = 0; j < LIST_ROUNDS; j++) {
+            checksum = 0;
+            matches = EnumerateWindowListFuzzy(
+                windowList, (char *)queries[q], TOP_K, addTopWindow,
+                (void *)&checksum
+            );
+        }
+        elapsed = now() - start;
+        printf(
+            "%-5s %-6s top %d of %ld windows x %d: %.1f ns/title, "
+            "%d matches, top %lx\n",
+            label, queries[q], TOP_K, (long)count, LIST_ROUNDS,
+            count ? elapsed * 1e9 / (count * LIST_ROUNDS) : 0.0,
+            matches, checksum
+        );
+    }
+}
+
+#ifdef MOCK_CARBON
+/* Make titles the mock's windows, split back into app and window names */
+static void setMockWindows(char **titles) {
+    MockWindow *windows;
+    char *sep;
+    int i;
+
+    windows = (MockWindow *)calloc(TITLES, sizeof(MockWindow));
+    for(i = 0; i < TITLES; i++) {
+        sep = strstr(titles[i], " - ");
+        windows[i].id = 100 + i;
+        windows[i].pid = getpid();
+        windows[i].onScreen = 1;
+        windows[i].bounds = CGRectMake(0, 0, 100, 100);
+        windows[i].appName = strndup(titles[i], sep - titles[i]);
+        windows[i].windowName = sep + 3;
+    }
+    MockCarbonSetWindows(windows, TITLES);
+    for(i = 0; i < TITLES; i++) free((char *)windows[i].appName);
+    free(windows);
+}
+#endif
+
+int main(int argc, char **argv) {
+    char **titles, **longTitles, buf[512], gap[61];
+    size_t *lengths, *longLengths;
+    CF_SCOPED CFArrayRef windowList = NULL;
+    int i;
+
+    /* A match whose gaps outweigh it must still count as a match */
+    memset(gap, 'a', sizeof(gap) - 1);
+    gap[sizeof(gap) - 1] = '\0';
+    snprintf(buf, sizeof(buf), "Finder - %s zoom", gap);
+    if(FuzzyScore("fz", buf, strlen(buf)) < 0) {
+        fprintf(stderr, "fuzzybench: \"fz\" does not match \"%s\"\n", buf);
+        return 1;
+    }
+
+    /* Build repeatable short titles, and long ones past the vector width */
+    srandom(1);
+    titles = (char **)malloc(TITLES * sizeof(char *));
+    lengths = (size_t *)malloc(TITLES * sizeof(size_t));
+    longTitles = (char **)malloc(TITLES * sizeof(char *));
+    longLengths = (size_t *)malloc(TITLES * sizeof(size_t));
+    for(i = 0; i < TITLES; i++) {
+        makeTitle(buf, sizeof(buf), 0);
+        titles[i] = strdup(buf);
+        lengths[i] = strlen(buf);
+        makeTitle(buf, sizeof(buf), 1);
+        longTitles[i] = strdup(buf);
+        longLengths[i] = strlen(buf);
+    }
+
+    bench("short", titles, lengths);
+    bench("long", longTitles, longLengths);
+#ifdef MOCK_CARBON
+    setMockWindows(titles);
+#endif
+    windowList = CopyWindowList();
+    benchList("list", windowList);
+
+    for(i = 0; i < TITLES; i++) {
+        free(titles[i]);
+        free(longTitles[i]);
+    }
+    free(titles);
+    free(lengths);
+    free(longTitles);
+    free(longLengths);
+
+    return 0;
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,301 @@
+/* ========================================================================
+ * historybench.c - size and seek time of a synthetic 8 hour history log
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "winhistory.h"
+
+#define ME "historybench"
+#define WINDOWS 60
+#define SAMPLES (8 * 60 * 60)  /* one a second for a working day */
+#define CHECKS 200
+#define QUERIES 2000
+#define LENGTHS 4             /* log lengths to time queries at, doubling */
+#define START_TIME 1700000000000LL
+
+static const char *apps[] = {
+    "iTerm2", "Firefox", "Google Chrome", "Finder", "Slack", "Xcode",
+    "Visual Studio Code", "Mail", "Calendar", "Preview"
+};
+
+/* Synthetic window, with room for its names */
+typedef struct {
+    WindowInfo info;
+    char appName[32];
+    char windowName[64];
+    int dragging;             /* seconds left in current drag */
+    int dx, dy;
+} FakeWindow;
+
+/* Return current time in seconds */
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Give window a new identity, as if one closed and another opened */
+static void openWindow(FakeWindow *window, CGWindowID id) {
+    window->info.id = id;
+    window->info.pid = 100 + random() % 10;
+    window->info.layer = 0;
+    window->info.bounds = CGRectMake(
+        random() % 1600, 25 + random() % 900,
+        400 + random() % 800, 300 + random() % 600
+    );
+    snprintf(
+        window->appName, sizeof(window->appName), "%s",
+        apps[window->info.pid % 10]
+    );
+    snprintf(
+        window->windowName, sizeof(window->windowName), "Document %ld",
+        random() % 1000
+    );
+    window->dragging = 0;
+}
+
+/* Append "id - title - x y w h" lines for windows to text, lswin -l style */
+static size_t formatWindows(const WindowInfo *windows, int count, char *text) {
+    size_t len = 0;
+    int i;
+
+    for(i = 0; i < count; i++) {
+        len += sprintf(
+            text + len, "%u - %s - %s - %d %d %d %d\n",
+            windows[i].id, windows[i].appName, windows[i].windowName,
+            (int)windows[i].bounds.origin.x, (int)windows[i].bounds.origin.y,
+            (int)windows[i].bounds.size.width,
+            (int)windows[i].bounds.size.height
+        );
+    }
+    return len;
+}
+
+/* Query at random times in the last minute of the first samples samples,
+ * so the log as far as a query reads it is that long; return us/query
+ */
+static double timeQueries(WinHistory *history, int samples) {
+    WindowInfo *found;
+    int64_t sampleTime;
+    double start;
+    int i;
+
+    start = now();
+    for(i = 0; i < QUERIES; i++) {
+        WinHistoryQuery(
+            history,
+            START_TIME + (int64_t)(samples - 1 - random() % 60) * 1000LL,
+            &found, &sampleTime
+        );
+        free(found);
+    }
+    return (now() - start) * 1e6 / QUERIES;
+}
+
+/* Reconstruct the checked samples, and at times between samples; return
+ * how many differ
+ */
+static int checkSamples(
+    WinHistory *history,
+    const int *checkAt,
+    char **expected,
+    char *text
+) {
+    WindowInfo *found;
+    int64_t sampleTime;
+    int c, count, failures;
+
+    for(c = 0, failures = 0; c < CHECKS; c++) {
+        count = WinHistoryQuery(
+            history, START_TIME + checkAt[c] * 1000LL + random() % 1000,
+            &found, &sampleTime
+        );
+        formatWindows(found, count, text);
+        if(count != WINDOWS ||
+           sampleTime != START_TIME + checkAt[c] * 1000LL ||
+           strcmp(text, expected[c]) != 0)
+        {
+            failures++;
+        }
+        free(found);
+    }
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    static FakeWindow windows[WINDOWS];
+    static char text[WINDOWS * 256];
+    WindowInfo sample[WINDOWS];
+    char path[] = "/tmp/" ME ".XXXXXX", indexPath[sizeof(path) + 4];
+    char hiddenPath[sizeof(path) + 8];
+    char **expected;
+    int checkAt[CHECKS];
+    int i, j, s, c, samples, failures, unindexedFailures;
+    CGWindowID nextId;
+    FakeWindow front;
+    WinHistory *history;
+    struct stat st;
+    size_t textBytes;
+    double start, elapsed, indexed, unindexed;
+
+    srandom(1);
+    close(mkstemp(path));
+    unlink(path);
+    snprintf(indexPath, sizeof(indexPath), "%s.idx", path);
+    snprintf(hiddenPath, sizeof(hiddenPath), "%s.noidx", path);
+    history = WinHistoryOpen(path, 1);
+    if(!history) {
+        fprintf(stderr, ME ": unable to create %s\n", path);
+        return 1;
+    }
+
+    /* Pick samples to check against afterwards, in order */
+    for(c = 0; c < CHECKS; c++) checkAt[c] = random() % SAMPLES;
+    for(c = 1; c < CHECKS; c++) {
+        for(j = c; j > 0 && checkAt[j - 1] > checkAt[j]; j--) {
+            s = checkAt[j];
+            checkAt[j] = checkAt[j - 1];
+            checkAt[j - 1] = s;
+        }
+    }
+    expected = (char **)calloc(CHECKS, sizeof(char *));
+
+    /* Record a day of mostly idle windows with the odd focus change,
+     * drag, title change, and window opening or closing
+     */
+    for(nextId = 1; nextId <= WINDOWS; nextId++) {
+        openWindow(&windows[nextId - 1], nextId);
+    }
+    textBytes = 0;
+    start = now();
+    for(s = 0, c = 0; s < SAMPLES; s++) {
+        if(random() % 20 == 0) {
+            i = random() % WINDOWS;
+            front = windows[i];
+            memmove(&windows[1], &windows[0], i * sizeof(FakeWindow));
+            windows[0] = front;
+        }
+        if(random() % 30 == 0) {
+            i = random() % WINDOWS;
+            windows[i].dragging = 3;
+            windows[i].dx = random() % 41 - 20;
+            windows[i].dy = random() % 41 - 20;
+        }
+        if(random() % 50 == 0) {
+            i = random() % WINDOWS;
+            snprintf(
+                windows[i].windowName, sizeof(windows[i].windowName),
+                "Document %ld", random() % 1000
+            );
+        }
+        if(random() % 500 == 0) {
+            openWindow(&windows[random() % WINDOWS], nextId++);
+        }
+
+        for(i = 0; i < WINDOWS; i++) {
+            if(windows[i].dragging > 0) {
+                windows[i].dragging--;
+                windows[i].info.bounds.origin.x += windows[i].dx;
+                windows[i].info.bounds.origin.y += windows[i].dy;
+            }
+            sample[i] = windows[i].info;
+            sample[i].appName = windows[i].appName;
+            sample[i].windowName = windows[i].windowName;
+            sample[i].title = "";
+        }
+        WinHistoryAppend(history, START_TIME + s * 1000LL, sample, WINDOWS);
+        textBytes += formatWindows(sample, WINDOWS, text);
+        for(; c < CHECKS && checkAt[c] == s; c++) {
+            formatWindows(sample, WINDOWS, text);
+            expected[c] = strdup(text);
+        }
+    }
+    elapsed = now() - start;
+    WinHistoryClose(history);
+    stat(path, &st);
+    printf(
+        "%d samples of %d windows: %.2f bytes/sample "
+        "(text dump %.0f bytes/sample), %.1f us/sample to record\n",
+        SAMPLES, WINDOWS, (double)st.st_size / SAMPLES,
+        (double)textBytes / SAMPLES, elapsed * 1e6 / SAMPLES
+    );
+
+    /* Reconstruct the checked samples, with the keyframe index and as
+     * if it were missing, which must give the same answers
+     */
+    history = WinHistoryOpen(path, 0);
+    failures = checkSamples(history, checkAt, expected, text);
+    WinHistoryClose(history);
+    rename(indexPath, hiddenPath);
+    history = WinHistoryOpen(path, 0);
+    unindexedFailures = checkSamples(history, checkAt, expected, text);
+    WinHistoryClose(history);
+    rename(hiddenPath, indexPath);
+    printf(
+        "%d of %d reconstructed samples differ (%d without index)\n",
+        failures, CHECKS, unindexedFailures
+    );
+    failures += unindexedFailures;
+    for(c = 0; c < CHECKS; c++) free(expected[c]);
+
+    /* Time queries against how much log comes before them, which should
+     * not matter with the index
+     */
+    for(samples = SAMPLES >> (LENGTHS - 1); samples <= SAMPLES; samples *= 2) {
+        history = WinHistoryOpen(path, 0);
+        indexed = timeQueries(history, samples);
+        WinHistoryClose(history);
+        rename(indexPath, hiddenPath);
+        history = WinHistoryOpen(path, 0);
+        unindexed = timeQueries(history, samples);
+        WinHistoryClose(history);
+        rename(hiddenPath, indexPath);
+        printf(
+            "%6d samples before query: %7.1f us/query "
+            "(%.1f us without index)\n",
+            samples, indexed, unindexed
+        );
+    }
+
+    unlink(path);
+    unlink(indexPath);
+    free(expected);
+
+    return failures ? 1 : 0;
+}
+
+
+/* ======================================================================== */
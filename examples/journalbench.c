@@ -0,0 +1,168 @@
+/* ========================================================================
+ * journalbench.c - time journal appends against accessibility moves
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <time.h>
+#include "winjournal.h"
+
+/* Built in examples/mock, where the accessibility calls are the mock's:
+ * set MOCKCARBON_AX_USEC to give each one a realistic latency, without
+ * which the numbers show the journal's own cost against a free move
+ */
+#define ME "journalbench"
+#define USAGE "usage: " ME " [-h] [-n moves] [journal]\n"
+#define FULL_USAGE USAGE \
+    "    -h        display this help text and exit\n" \
+    "    -n moves  moves to time each way (default 20000)\n" \
+    "    journal   journal file to append to (default a temporary file)\n"
+
+/* Return monotonic time in seconds, finer grained than gettimeofday() */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Sort times in ascending order */
+static int compareTimes(const void *a, const void *b) {
+    double timeA = *(const double *)a, timeB = *(const double *)b;
+    return (timeA > timeB) - (timeA < timeB);
+}
+
+/* Print 50th and 99th percentile of n times, in microseconds */
+static void report(const char *label, double *times, int n) {
+    qsort(times, n, sizeof(double), compareTimes);
+    printf(
+        "%-16s p50 %7.2f us  p99 %7.2f us\n",
+        label, times[n / 2] * 1e6, times[n * 99 / 100] * 1e6
+    );
+}
+
+int main(int argc, char **argv) {
+    char path[] = "/tmp/journalbenchXXXXXX", *journalPath = NULL;
+    CFArrayRef windowList;
+    CFDictionaryRef window;
+    AXUIElementRef appWindow;
+    WinJournal *journal;
+    double *moveTimes, *journalTimes, *appendTimes, start, end;
+    CGPoint oldPosition, newPosition;
+    CGSize size;
+    uint32_t batch;
+    int ch, i, n = 20000, fd = -1;
+
+#define DIE(msg) { fprintf(stderr, ME ": " msg "\n"); exit(1); }
+#define DIE_OPT(msg) \
+    { fprintf(stderr, ME ": " msg " -- %c\n" USAGE, optopt); return 1; }
+
+    while((ch = getopt(argc, argv, ":hn:")) != -1) {
+        switch(ch) {
+            case 'h':
+                printf(FULL_USAGE);
+                return 0;
+            case 'n':
+                n = atoi(optarg);
+                if(n <= 0) DIE("moves must be positive integer");
+                break;
+            case ':':
+                DIE_OPT("option requires an argument");
+            default:
+                DIE_OPT("illegal option");
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if(argc > 0) {
+        journalPath = argv[0];
+    } else {
+        fd = mkstemp(path);
+        if(fd == -1) DIE("unable to create temporary journal");
+        journalPath = path;
+    }
+
+    journal = WinJournalOpen(journalPath);
+    if(!journal) DIE("unable to open journal");
+    windowList = CopyWindowList();
+    if(!windowList || CFArrayGetCount(windowList) == 0) DIE("no windows");
+    window = CFArrayGetValueAtIndex(windowList, 0);
+    appWindow = AXWindowFromCGWindow(window);
+    if(!appWindow) DIE("unable to get accessibility object for window");
+    oldPosition = CGWindowGetPosition(window);
+    size = CGWindowGetSize(window);
+
+    /* Time the same move alone, with a journal append (and its two
+     * flock() calls) after it, and the append alone
+     */
+    moveTimes = (double *)malloc(n * sizeof(double));
+    journalTimes = (double *)malloc(n * sizeof(double));
+    appendTimes = (double *)malloc(n * sizeof(double));
+    batch = WinJournalBeginBatch(journal);
+    for(i = 0; i < n; i++) {
+        newPosition = CGPointMake(oldPosition.x + i % 2, oldPosition.y);
+        start = now();
+        AXWindowSetPosition(appWindow, newPosition);
+        moveTimes[i] = now() - start;
+
+        start = now();
+        AXWindowSetPosition(appWindow, newPosition);
+        end = now();
+        WinJournalAppend(
+            journal, batch, window, oldPosition, size, newPosition, size
+        );
+        appendTimes[i] = now() - end;
+        journalTimes[i] = now() - start;
+    }
+    report("move", moveTimes, n);
+    report("move + journal", journalTimes, n);
+    report("journal only", appendTimes, n);
+
+    free(moveTimes);
+    free(journalTimes);
+    free(appendTimes);
+    CFRelease(appWindow);
+    CFRelease(windowList);
+    WinJournalClose(journal);
+    if(fd != -1) {
+        close(fd);
+        unlink(path);
+    }
+
+    return 0;
+
+#undef DIE_OPT
+#undef DIE
+}
+
+
+/* ======================================================================== */
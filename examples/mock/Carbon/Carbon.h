@@ -0,0 +1,272 @@
+/* ========================================================================
+ * Carbon.h - just enough of Carbon to build movewin on Linux
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+/* This is not Apple's header. It declares the handful of CoreFoundation,
+ * CoreGraphics, and accessibility types and functions that movewin uses,
+ * so that its sources compile unchanged (see Makefile in this directory)
+ * against the synthetic window server in mockcarbon.c.
+ */
+
+#ifndef MOCK_CARBON_H
+#define MOCK_CARBON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* Lets programs tell they are running against mockcarbon.c */
+#define MOCK_CARBON 1
+
+/* Build the Catalina and later code paths */
+#define MAC_OS_X_VERSION_MIN_REQUIRED 101500
+
+/* CoreFoundation */
+typedef const void *CFTypeRef;
+typedef const struct __CFString *CFStringRef;
+typedef const struct __CFNumber *CFNumberRef;
+typedef const struct __CFArray *CFArrayRef;
+typedef const struct __CFDictionary *CFDictionaryRef;
+typedef const struct __CFAllocator *CFAllocatorRef;
+typedef long CFIndex;
+typedef struct { CFIndex location, length; } CFRange;
+typedef uint32_t CFStringEncoding;
+typedef uint16_t UniChar;
+typedef unsigned char Boolean;
+typedef int CFNumberType;
+typedef int CFComparisonResult;
+typedef struct CFArrayCallBacks CFArrayCallBacks;
+
+enum { kCFStringEncodingASCII = 0x0600, kCFStringEncodingUTF8 = 0x08000100 };
+enum { kCFNumberSInt32Type = 3, kCFNumberIntType = 9 };
+enum {
+    kCFCompareLessThan = -1, kCFCompareEqualTo = 0, kCFCompareGreaterThan = 1
+};
+
+#define CFSTR(s) MockCFSTR(s)
+CFStringRef MockCFSTR(const char *s);
+
+CFTypeRef CFRetain(CFTypeRef cf);
+void CFRelease(CFTypeRef cf);
+CFIndex CFGetRetainCount(CFTypeRef cf);
+
+static inline CFRange CFRangeMake(CFIndex location, CFIndex length) {
+    CFRange range = { location, length };
+    return range;
+}
+
+CFArrayRef CFArrayCreate(
+    CFAllocatorRef allocator, const void **values, CFIndex count,
+    const CFArrayCallBacks *callBacks
+);
+CFIndex CFArrayGetCount(CFArrayRef array);
+const void *CFArrayGetValueAtIndex(CFArrayRef array, CFIndex index);
+void CFArrayGetValues(CFArrayRef array, CFRange range, const void **values);
+extern const CFArrayCallBacks kCFTypeArrayCallBacks;
+
+const void *CFDictionaryGetValue(CFDictionaryRef dict, const void *key);
+
+Boolean CFNumberGetValue(CFNumberRef number, CFNumberType type, void *value);
+
+CFStringRef CFStringCreateWithCString(
+    CFAllocatorRef allocator, const char *cstr, CFStringEncoding encoding
+);
+CFIndex CFStringGetLength(CFStringRef string);
+CFIndex CFStringGetMaximumSizeForEncoding(
+    CFIndex length, CFStringEncoding encoding
+);
+Boolean CFStringGetCString(
+    CFStringRef string, char *buffer, CFIndex size, CFStringEncoding encoding
+);
+const char *CFStringGetCStringPtr(
+    CFStringRef string, CFStringEncoding encoding
+);
+const UniChar *CFStringGetCharactersPtr(CFStringRef string);
+void CFStringGetCharacters(CFStringRef string, CFRange range, UniChar *buf);
+CFComparisonResult CFStringCompare(
+    CFStringRef a, CFStringRef b, unsigned long options
+);
+
+/* CoreGraphics geometry */
+typedef double CGFloat;
+typedef struct { CGFloat x, y; } CGPoint;
+typedef struct { CGFloat width, height; } CGSize;
+typedef struct { CGPoint origin; CGSize size; } CGRect;
+
+static inline CGPoint CGPointMake(CGFloat x, CGFloat y) {
+    CGPoint point = { x, y };
+    return point;
+}
+static inline CGSize CGSizeMake(CGFloat width, CGFloat height) {
+    CGSize size = { width, height };
+    return size;
+}
+static inline CGRect CGRectMake(
+    CGFloat x, CGFloat y, CGFloat width, CGFloat height
+) {
+    CGRect rect = { { x, y }, { width, height } };
+    return rect;
+}
+static inline bool CGPointEqualToPoint(CGPoint a, CGPoint b) {
+    return a.x == b.x && a.y == b.y;
+}
+static inline bool CGSizeEqualToSize(CGSize a, CGSize b) {
+    return a.width == b.width && a.height == b.height;
+}
+static inline bool CGRectEqualToRect(CGRect a, CGRect b) {
+    return CGPointEqualToPoint(a.origin, b.origin) &&
+        CGSizeEqualToSize(a.size, b.size);
+}
+static inline CGRect CGRectStandardize(CGRect rect) {
+    if(rect.size.width < 0) {
+        rect.origin.x += rect.size.width;
+        rect.size.width = -rect.size.width;
+    }
+    if(rect.size.height < 0) {
+        rect.origin.y += rect.size.height;
+        rect.size.height = -rect.size.height;
+    }
+    return rect;
+}
+static inline CGFloat CGRectGetMinX(CGRect rect) {
+    return CGRectStandardize(rect).origin.x;
+}
+static inline CGFloat CGRectGetMinY(CGRect rect) {
+    return CGRectStandardize(rect).origin.y;
+}
+static inline CGFloat CGRectGetMaxX(CGRect rect) {
+    rect = CGRectStandardize(rect);
+    return rect.origin.x + rect.size.width;
+}
+static inline CGFloat CGRectGetMaxY(CGRect rect) {
+    rect = CGRectStandardize(rect);
+    return rect.origin.y + rect.size.height;
+}
+
+/* CoreGraphics displays and window lists */
+typedef int32_t CGError;
+typedef uint32_t CGDirectDisplayID;
+typedef uint32_t CGWindowID;
+typedef uint32_t CGWindowListOption;
+
+enum { kCGErrorSuccess = 0, kCGErrorFailure = 1000 };
+enum {
+    kCGWindowListOptionAll = 0,
+    kCGWindowListOptionOnScreenOnly = 1 << 0,
+    kCGWindowListOptionOnScreenAboveWindow = 1 << 1,
+    kCGWindowListOptionOnScreenBelowWindow = 1 << 2,
+    kCGWindowListOptionIncludingWindow = 1 << 3,
+    kCGWindowListExcludeDesktopElements = 1 << 4
+};
+#define kCGNullWindowID ((CGWindowID)0)
+
+extern const CFStringRef kCGWindowNumber, kCGWindowOwnerPID, kCGWindowLayer,
+    kCGWindowBounds, kCGWindowOwnerName, kCGWindowName;
+
+CGDirectDisplayID CGMainDisplayID(void);
+CGRect CGDisplayBounds(CGDirectDisplayID display);
+CGError CGGetActiveDisplayList(
+    uint32_t maxDisplays, CGDirectDisplayID *displays, uint32_t *count
+);
+
+CFArrayRef CGWindowListCopyWindowInfo(
+    CGWindowListOption option, CGWindowID relativeToWindow
+);
+CFArrayRef CGWindowListCreate(
+    CGWindowListOption option, CGWindowID relativeToWindow
+);
+CFArrayRef CGWindowListCreateDescriptionFromArray(CFArrayRef windowArray);
+
+/* Display streams, only as far as the screen recording probe needs; the
+ * frame handler is a block on macOS, which the mock never calls
+ */
+typedef const struct __CGDisplayStream *CGDisplayStreamRef;
+typedef const struct __CGDisplayStreamUpdate *CGDisplayStreamUpdateRef;
+typedef struct __IOSurface *IOSurfaceRef;
+typedef int32_t CGDisplayStreamFrameStatus;
+typedef void *CGDisplayStreamFrameAvailableHandler;
+
+CGDisplayStreamRef CGDisplayStreamCreate(
+    CGDirectDisplayID display, size_t outputWidth, size_t outputHeight,
+    int32_t pixelFormat, CFDictionaryRef properties,
+    CGDisplayStreamFrameAvailableHandler handler
+);
+
+/* Accessibility */
+typedef const struct __AXUIElement *AXUIElementRef;
+typedef const struct __AXValue *AXValueRef;
+typedef int32_t AXError;
+typedef uint32_t AXValueType;
+
+enum {
+    kAXErrorSuccess = 0,
+    kAXErrorFailure = -25200,
+    kAXErrorAttributeUnsupported = -25205
+};
+enum { kAXValueCGPointType = 1, kAXValueCGSizeType = 2 };
+
+extern const CFStringRef kAXWindowsAttribute, kAXTitleAttribute,
+    kAXPositionAttribute, kAXSizeAttribute;
+
+Boolean AXIsProcessTrusted(void);
+AXUIElementRef AXUIElementCreateApplication(pid_t pid);
+AXError AXUIElementCopyAttributeValue(
+    AXUIElementRef element, CFStringRef attribute, CFTypeRef *value
+);
+AXError AXUIElementSetAttributeValue(
+    AXUIElementRef element, CFStringRef attribute, CFTypeRef value
+);
+AXValueRef AXValueCreate(AXValueType type, const void *valuePtr);
+Boolean AXValueGetValue(AXValueRef value, AXValueType type, void *valuePtr);
+AXValueType AXValueGetType(AXValueRef value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !MOCK_CARBON_H */
+
+
+/* ======================================================================== */
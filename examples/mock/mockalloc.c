@@ -0,0 +1,78 @@
+/* ========================================================================
+ * mockalloc.c - count live heap blocks by interposing malloc and free
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <stdatomic.h>
+#include "mockcarbon.h"
+
+/* The glibc allocator under the names this file takes over */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static atomic_long liveBlocks;
+
+void *malloc(size_t size) {
+    void *ptr = __libc_malloc(size);
+    if(ptr) atomic_fetch_add(&liveBlocks, 1);
+    return ptr;
+}
+
+void *calloc(size_t count, size_t size) {
+    void *ptr = __libc_calloc(count, size);
+    if(ptr) atomic_fetch_add(&liveBlocks, 1);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+    void *newPtr = __libc_realloc(ptr, size);
+    if(!ptr && newPtr) atomic_fetch_add(&liveBlocks, 1);
+    if(ptr && !newPtr && size == 0) atomic_fetch_sub(&liveBlocks, 1);
+    return newPtr;
+}
+
+void free(void *ptr) {
+    if(ptr) atomic_fetch_sub(&liveBlocks, 1);
+    __libc_free(ptr);
+}
+
+/* Number of blocks allocated and not yet freed */
+long MockAllocLiveBlocks(void) {
+    return atomic_load(&liveBlocks);
+}
+
+
+/* ======================================================================== */
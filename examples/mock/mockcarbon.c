@@ -0,0 +1,1038 @@
+/* ========================================================================
+ * mockcarbon.c - synthetic window server behind the mock Carbon.h
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "mockcarbon.h"
+
+/* Every mock object starts with this; constants are never freed */
+typedef enum {
+    MOCK_STRING, MOCK_NUMBER, MOCK_ARRAY, MOCK_DICTIONARY,
+    MOCK_AX_ELEMENT, MOCK_AX_VALUE, MOCK_DISPLAY_STREAM
+} MockType;
+
+typedef struct {
+    MockType type;
+    atomic_int refCount;
+    int constant;
+} MockObject;
+
+struct __CFString {
+    MockObject base;
+    const char *utf8;
+    UniChar *chars;           /* UTF-16 form, NULL if ASCII */
+    CFIndex length;           /* in UTF-16 units */
+};
+
+struct __CFNumber {
+    MockObject base;
+    int value;
+};
+
+struct __CFArray {
+    MockObject base;
+    CFIndex count;
+    const void **values;
+    int ownsValues;           /* holds a reference to each value */
+};
+
+struct __CFDictionary {
+    MockObject base;
+    CFIndex count;
+    CFStringRef *keys;        /* constants, not owned */
+    CFTypeRef *values;        /* owned */
+};
+
+struct __AXUIElement {
+    MockObject base;
+    pid_t pid;
+    CGWindowID windowId;      /* 0 for an application */
+};
+
+struct __AXValue {
+    MockObject base;
+    AXValueType type;
+    CGPoint point;
+    CGSize size;
+};
+
+struct __CGDisplayStream {
+    MockObject base;
+};
+
+struct CFArrayCallBacks {
+    int retainsValues;
+};
+const CFArrayCallBacks kCFTypeArrayCallBacks = { 1 };
+
+/* Constant strings */
+#define CONSTANT_STRING(name, s) \
+    static struct __CFString name##Storage = \
+        { { MOCK_STRING, 1, 1 }, s, NULL, sizeof(s) - 1 }; \
+    const CFStringRef name = &name##Storage
+CONSTANT_STRING(kCGWindowNumber, "kCGWindowNumber");
+CONSTANT_STRING(kCGWindowOwnerPID, "kCGWindowOwnerPID");
+CONSTANT_STRING(kCGWindowLayer, "kCGWindowLayer");
+CONSTANT_STRING(kCGWindowBounds, "kCGWindowBounds");
+CONSTANT_STRING(kCGWindowOwnerName, "kCGWindowOwnerName");
+CONSTANT_STRING(kCGWindowName, "kCGWindowName");
+CONSTANT_STRING(kAXWindowsAttribute, "AXWindows");
+CONSTANT_STRING(kAXTitleAttribute, "AXTitle");
+CONSTANT_STRING(kAXPositionAttribute, "AXPosition");
+CONSTANT_STRING(kAXSizeAttribute, "AXSize");
+CONSTANT_STRING(boundsX, "X");
+CONSTANT_STRING(boundsY, "Y");
+CONSTANT_STRING(boundsWidth, "Width");
+CONSTANT_STRING(boundsHeight, "Height");
+#undef CONSTANT_STRING
+
+/* Longest generated window name, with its terminator */
+#define GENERATED_NAME_SIZE 32
+
+/* Per application counts */
+#define MAX_APPS 256
+typedef struct {
+    pid_t pid;
+    long windowLists;
+} AppCounts;
+
+/* The synthetic window server; lock guards windows and apps */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static MockWindow *windows;
+static int numWindows;
+static int numSynthetic, syntheticApps;   /* made up as listed, if any */
+static AppCounts apps[MAX_APPS];
+static int numApps;
+static atomic_int authorized = 1;
+static atomic_int probeUsec, axUsec;
+static atomic_long owned, retained, released, windowLists, probes;
+static atomic_long appWindowLists, attributeSets, liveObjects;
+
+static void setWindows(const MockWindow *newWindows, int count);
+static void makeWindows(int count, int numApps);
+
+/* Read an integer setting from the environment */
+static int envInt(const char *name, int defaultValue) {
+    const char *value = getenv(name);
+    return value && *value ? atoi(value) : defaultValue;
+}
+
+/* Set up default windows and settings from the environment, once */
+static void initialize() {
+    if(getenv("MOCKCARBON_UNAUTHORIZED")) atomic_store(&authorized, 0);
+    atomic_store(&probeUsec, envInt("MOCKCARBON_PROBE_USEC", 0));
+    atomic_store(&axUsec, envInt("MOCKCARBON_AX_USEC", 0));
+    makeWindows(
+        envInt("MOCKCARBON_WINDOWS", 12), envInt("MOCKCARBON_APPS", 4)
+    );
+}
+
+static void initializeOnce() {
+    pthread_once(&once, initialize);
+}
+
+/* Allocate a mock object with one reference, owned by whoever asked */
+static void *newObject(MockType type, size_t size) {
+    MockObject *object = (MockObject *)calloc(1, size);
+    object->type = type;
+    atomic_init(&object->refCount, 1);
+    atomic_fetch_add(&liveObjects, 1);
+    return object;
+}
+
+/* Hand a new object to the caller of a Create or Copy function */
+static CFTypeRef handOut(CFTypeRef cf) {
+    if(cf) atomic_fetch_add(&owned, 1);
+    return cf;
+}
+
+static void dropReference(CFTypeRef cf);
+
+/* Free an object whose last reference is gone */
+static void destroy(MockObject *object) {
+    CFIndex i;
+
+    switch(object->type) {
+        case MOCK_STRING:
+            free((char *)((struct __CFString *)object)->utf8);
+            free(((struct __CFString *)object)->chars);
+            break;
+        case MOCK_ARRAY: {
+            struct __CFArray *array = (struct __CFArray *)object;
+            if(array->ownsValues) {
+                for(i = 0; i < array->count; i++) {
+                    dropReference(array->values[i]);
+                }
+            }
+            free(array->values);
+            break;
+        }
+        case MOCK_DICTIONARY: {
+            struct __CFDictionary *dict = (struct __CFDictionary *)object;
+            for(i = 0; i < dict->count; i++) dropReference(dict->values[i]);
+            free(dict->keys);
+            free(dict->values);
+            break;
+        }
+        default:
+            break;
+    }
+    atomic_fetch_sub(&liveObjects, 1);
+    free(object);
+}
+
+/* Give up a reference without counting it as a caller's CFRelease() */
+static void dropReference(CFTypeRef cf) {
+    MockObject *object = (MockObject *)cf;
+    int refCount;
+
+    if(!object || object->constant) return;
+    refCount = atomic_fetch_sub(&object->refCount, 1);
+    if(refCount <= 0) {
+        fprintf(stderr, "mockcarbon: object %p over-released\n", cf);
+        abort();
+    }
+    if(refCount == 1) destroy(object);
+}
+
+CFTypeRef CFRetain(CFTypeRef cf) {
+    MockObject *object = (MockObject *)cf;
+    if(!object) abort();
+    atomic_fetch_add(&retained, 1);
+    if(!object->constant) atomic_fetch_add(&object->refCount, 1);
+    return cf;
+}
+
+void CFRelease(CFTypeRef cf) {
+    if(!cf) abort();
+    atomic_fetch_add(&released, 1);
+    dropReference(cf);
+}
+
+CFIndex CFGetRetainCount(CFTypeRef cf) {
+    return atomic_load(&((MockObject *)cf)->refCount);
+}
+
+/* Make a string from UTF-8, keeping a UTF-16 copy unless it is ASCII */
+static struct __CFString *newString(const char *utf8) {
+    struct __CFString *string;
+    const unsigned char *s;
+    unsigned int c;
+    int ascii = 1, extra;
+    CFIndex n;
+
+    string = (struct __CFString *)newObject(
+        MOCK_STRING, sizeof(struct __CFString)
+    );
+    string->utf8 = strdup(utf8);
+    for(s = (const unsigned char *)utf8; *s; s++) {
+        if(*s >= 0x80) ascii = 0;
+    }
+    if(ascii) {
+        string->length = strlen(utf8);
+        return string;
+    }
+
+    /* Decode UTF-8 into UTF-16, with surrogate pairs above U+FFFF */
+    string->chars = (UniChar *)malloc((strlen(utf8) + 1) * sizeof(UniChar));
+    for(n = 0, s = (const unsigned char *)utf8; *s; ) {
+        if(*s < 0x80) {
+            c = *s++;
+            extra = 0;
+        } else if(*s < 0xE0) {
+            c = *s++ & 0x1F;
+            extra = 1;
+        } else if(*s < 0xF0) {
+            c = *s++ & 0x0F;
+            extra = 2;
+        } else {
+            c = *s++ & 0x07;
+            extra = 3;
+        }
+        for(; extra > 0 && (*s & 0xC0) == 0x80; extra--) {
+            c = (c << 6) | (*s++ & 0x3F);
+        }
+        if(c >= 0x10000) {
+            c -= 0x10000;
+            string->chars[n++] = 0xD800 + (c >> 10);
+            string->chars[n++] = 0xDC00 + (c & 0x3FF);
+        } else {
+            string->chars[n++] = c;
+        }
+    }
+    string->length = n;
+    return string;
+}
+
+/* CFSTR() constants, interned and never freed */
+CFStringRef MockCFSTR(const char *s) {
+    static struct __CFString **interned;
+    static int numInterned;
+    struct __CFString *string = NULL;
+    int i;
+
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < numInterned && !string; i++) {
+        if(strcmp(interned[i]->utf8, s) == 0) string = interned[i];
+    }
+    if(!string) {
+        string = newString(s);
+        string->base.constant = 1;
+        atomic_fetch_sub(&liveObjects, 1);
+        interned = (struct __CFString **)realloc(
+            interned, (numInterned + 1) * sizeof(struct __CFString *)
+        );
+        interned[numInterned++] = string;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return string;
+}
+
+CFStringRef CFStringCreateWithCString(
+    CFAllocatorRef allocator, const char *cstr, CFStringEncoding encoding
+) {
+    return handOut(newString(cstr));
+}
+
+CFIndex CFStringGetLength(CFStringRef string) {
+    return string->length;
+}
+
+CFIndex CFStringGetMaximumSizeForEncoding(
+    CFIndex length, CFStringEncoding encoding
+) {
+    return encoding == kCFStringEncodingUTF8 ? 3 * length : length;
+}
+
+/* Like CF, copy out ASCII as is, but encode a string kept as UTF-16 one
+ * unit at a time, so one-by-one conversion costs what it does on macOS
+ */
+Boolean CFStringGetCString(
+    CFStringRef string, char *buffer, CFIndex size, CFStringEncoding encoding
+) {
+    unsigned char *out = (unsigned char *)buffer;
+    unsigned int c;
+    CFIndex i, need;
+
+    if(!string->chars) {
+        if(string->length + 1 > size) return 0;
+        memcpy(buffer, string->utf8, string->length + 1);
+        return 1;
+    }
+    for(i = 0; i < string->length; i++) {
+        c = string->chars[i];
+        if(c >= 0xD800 && c < 0xDC00 && i + 1 < string->length) {
+            c = 0x10000 + ((c - 0xD800) << 10) +
+                (string->chars[++i] - 0xDC00);
+        }
+        need = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        if(out + need + 1 > (unsigned char *)buffer + size) return 0;
+        if(need == 1) {
+            *out++ = c;
+        } else if(need == 2) {
+            *out++ = 0xC0 | (c >> 6);
+            *out++ = 0x80 | (c & 0x3F);
+        } else if(need == 3) {
+            *out++ = 0xE0 | (c >> 12);
+            *out++ = 0x80 | ((c >> 6) & 0x3F);
+            *out++ = 0x80 | (c & 0x3F);
+        } else {
+            *out++ = 0xF0 | (c >> 18);
+            *out++ = 0x80 | ((c >> 12) & 0x3F);
+            *out++ = 0x80 | ((c >> 6) & 0x3F);
+            *out++ = 0x80 | (c & 0x3F);
+        }
+    }
+    *out = '\0';
+    return 1;
+}
+
+/* Like CF, only hand out internal storage for the encoding it is in */
+const char *CFStringGetCStringPtr(
+    CFStringRef string, CFStringEncoding encoding
+) {
+    return string->chars ? NULL : string->utf8;
+}
+
+const UniChar *CFStringGetCharactersPtr(CFStringRef string) {
+    return string->chars;
+}
+
+void CFStringGetCharacters(CFStringRef string, CFRange range, UniChar *buf) {
+    CFIndex i;
+
+    for(i = 0; i < range.length; i++) {
+        buf[i] = string->chars ?
+            string->chars[range.location + i] :
+            (unsigned char)string->utf8[range.location + i];
+    }
+}
+
+CFComparisonResult CFStringCompare(
+    CFStringRef a, CFStringRef b, unsigned long options
+) {
+    int result = strcmp(a->utf8, b->utf8);
+    return result < 0 ? kCFCompareLessThan :
+        result > 0 ? kCFCompareGreaterThan : kCFCompareEqualTo;
+}
+
+static struct __CFNumber *newNumber(int value) {
+    struct __CFNumber *number = (struct __CFNumber *)newObject(
+        MOCK_NUMBER, sizeof(struct __CFNumber)
+    );
+    number->value = value;
+    return number;
+}
+
+Boolean CFNumberGetValue(CFNumberRef number, CFNumberType type, void *value) {
+    if(!number || number->base.type != MOCK_NUMBER) return 0;
+    *(int *)value = number->value;
+    return 1;
+}
+
+/* Array taking over the references of values if ownsValues */
+static struct __CFArray *newArray(
+    const void **values,
+    CFIndex count,
+    int ownsValues
+) {
+    struct __CFArray *array = (struct __CFArray *)newObject(
+        MOCK_ARRAY, sizeof(struct __CFArray)
+    );
+    array->count = count;
+    array->ownsValues = ownsValues;
+    array->values = (const void **)malloc((count + 1) * sizeof(void *));
+    if(count > 0) memcpy(array->values, values, count * sizeof(void *));
+    return array;
+}
+
+CFArrayRef CFArrayCreate(
+    CFAllocatorRef allocator, const void **values, CFIndex count,
+    const CFArrayCallBacks *callBacks
+) {
+    struct __CFArray *array;
+    CFIndex i;
+
+    array = newArray(values, count, callBacks && callBacks->retainsValues);
+    if(array->ownsValues) {
+        for(i = 0; i < count; i++) {
+            atomic_fetch_add(&((MockObject *)values[i])->refCount, 1);
+        }
+    }
+    return handOut(array);
+}
+
+CFIndex CFArrayGetCount(CFArrayRef array) {
+    return array->count;
+}
+
+const void *CFArrayGetValueAtIndex(CFArrayRef array, CFIndex index) {
+    if(index < 0 || index >= array->count) abort();
+    return array->values[index];
+}
+
+void CFArrayGetValues(CFArrayRef array, CFRange range, const void **values) {
+    if(range.location < 0 || range.location + range.length > array->count) {
+        abort();
+    }
+    memcpy(
+        values, array->values + range.location, range.length * sizeof(void *)
+    );
+}
+
+/* Dictionary of up to capacity keys, filled in by addValue() */
+static struct __CFDictionary *newDictionary(int capacity) {
+    struct __CFDictionary *dict = (struct __CFDictionary *)newObject(
+        MOCK_DICTIONARY, sizeof(struct __CFDictionary)
+    );
+    dict->keys = (CFStringRef *)malloc(capacity * sizeof(CFStringRef));
+    dict->values = (CFTypeRef *)malloc(capacity * sizeof(CFTypeRef));
+    return dict;
+}
+
+/* Add value to dictionary, which takes over its reference */
+static void addValue(
+    struct __CFDictionary *dict,
+    CFStringRef key,
+    CFTypeRef value
+) {
+    dict->keys[dict->count] = key;
+    dict->values[dict->count++] = value;
+}
+
+const void *CFDictionaryGetValue(CFDictionaryRef dict, const void *key) {
+    CFIndex i;
+
+    if(!dict || dict->base.type != MOCK_DICTIONARY) return NULL;
+    for(i = 0; i < dict->count; i++) {
+        if(dict->keys[i] == key ||
+           CFStringCompare(dict->keys[i], (CFStringRef)key, 0) == 0)
+        {
+            return dict->values[i];
+        }
+    }
+    return NULL;
+}
+
+/* Replace every window, in front to back order */
+static void setWindows(const MockWindow *newWindows, int count) {
+    int i;
+
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < numWindows; i++) {
+        free((char *)windows[i].appName);
+        free((char *)windows[i].windowName);
+    }
+    windows = (MockWindow *)realloc(
+        windows, (count + 1) * sizeof(MockWindow)
+    );
+    for(i = 0; i < count; i++) {
+        windows[i] = newWindows[i];
+        if(windows[i].appName) windows[i].appName = strdup(windows[i].appName);
+        if(windows[i].windowName) {
+            windows[i].windowName = strdup(windows[i].windowName);
+        }
+    }
+    numWindows = count;
+    numSynthetic = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+void MockCarbonSetWindows(const MockWindow *newWindows, int count) {
+    initializeOnce();
+    setWindows(newWindows, count);
+}
+
+/* Generate window i of numApps applications, naming it in name */
+static void generateWindow(
+    int i,
+    int numApps,
+    MockWindow *window,
+    char name[GENERATED_NAME_SIZE]
+) {
+    static const char *appNames[] = {
+        "Terminal", "Firefox", "Finder", "Mail", "Xcode", "Preview",
+        "Slack", "Notes"
+    };
+    int numAppNames = sizeof(appNames) / sizeof(appNames[0]);
+    int app = i % numApps;
+
+    snprintf(name, GENERATED_NAME_SIZE, "Window %d", i / numApps + 1);
+    window->id = 100 + i;
+    window->pid = 1000 + app;
+    window->layer = 0;
+    window->onScreen = 1;
+    window->bounds = CGRectMake(40 * (i % 20), 22 + 30 * (i % 20), 800, 600);
+    window->appName = appNames[app % numAppNames];
+    window->windowName = name;
+}
+
+/* Replace every window with count generated ones */
+static void makeWindows(int count, int numApps) {
+    MockWindow *made;
+    char **names;
+    int i;
+
+    if(numApps < 1) numApps = 1;
+    made = (MockWindow *)calloc(count + 1, sizeof(MockWindow));
+    names = (char **)calloc(count + 1, sizeof(char *));
+    for(i = 0; i < count; i++) {
+        names[i] = (char *)malloc(GENERATED_NAME_SIZE);
+        generateWindow(i, numApps, &made[i], names[i]);
+    }
+    setWindows(made, count);
+    for(i = 0; i < count; i++) free(names[i]);
+    free(names);
+    free(made);
+}
+
+void MockCarbonMakeWindows(int count, int numApps) {
+    initializeOnce();
+    makeWindows(count, numApps);
+}
+
+void MockCarbonMakeSyntheticWindows(int count, int numApps) {
+    initializeOnce();
+    setWindows(NULL, 0);
+    pthread_mutex_lock(&lock);
+    numSynthetic = count;
+    syntheticApps = numApps < 1 ? 1 : numApps;
+    pthread_mutex_unlock(&lock);
+}
+
+/* Copy current state of window with given ID; strings stay owned here */
+int MockCarbonGetWindow(CGWindowID id, MockWindow *window) {
+    int i, found = -1;
+
+    initializeOnce();
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < numWindows && found == -1; i++) {
+        if(windows[i].id == id) {
+            *window = windows[i];
+            found = 0;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return found;
+}
+
+void MockCarbonSetAuthorized(int isAuthorized) {
+    initializeOnce();
+    atomic_store(&authorized, isAuthorized);
+}
+
+void MockCarbonSetLatency(int probe, int ax) {
+    initializeOnce();
+    atomic_store(&probeUsec, probe);
+    atomic_store(&axUsec, ax);
+}
+
+void MockCarbonGetCounts(MockCarbonCounts *counts) {
+    counts->owned = atomic_load(&owned);
+    counts->retained = atomic_load(&retained);
+    counts->released = atomic_load(&released);
+    counts->windowLists = atomic_load(&windowLists);
+    counts->probes = atomic_load(&probes);
+    counts->appWindowLists = atomic_load(&appWindowLists);
+    counts->attributeSets = atomic_load(&attributeSets);
+}
+
+void MockCarbonResetCounts(void) {
+    atomic_store(&owned, 0);
+    atomic_store(&retained, 0);
+    atomic_store(&released, 0);
+    atomic_store(&windowLists, 0);
+    atomic_store(&probes, 0);
+    atomic_store(&appWindowLists, 0);
+    atomic_store(&attributeSets, 0);
+    pthread_mutex_lock(&lock);
+    numApps = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+long MockCarbonAppWindowLists(pid_t pid) {
+    long count = 0;
+    int i;
+
+    pthread_mutex_lock(&lock);
+    for(i = 0; i < numApps; i++) {
+        if(apps[i].pid == pid) count = apps[i].windowLists;
+    }
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+long MockCarbonLiveObjects(void) {
+    return atomic_load(&liveObjects);
+}
+
+CGDirectDisplayID CGMainDisplayID(void) {
+    return 1;
+}
+
+CGRect CGDisplayBounds(CGDirectDisplayID display) {
+    return CGRectMake(0, 0, 1440, 900);
+}
+
+CGError CGGetActiveDisplayList(
+    uint32_t maxDisplays, CGDirectDisplayID *displays, uint32_t *count
+) {
+    if(displays && maxDisplays > 0) displays[0] = CGMainDisplayID();
+    *count = 1;
+    return kCGErrorSuccess;
+}
+
+/* Window description as CGWindowListCopyWindowInfo() makes it; windows
+ * of other processes have no name without screen recording permission
+ */
+static CFDictionaryRef describeWindow(const MockWindow *window) {
+    struct __CFDictionary *dict, *bounds;
+
+    bounds = newDictionary(4);
+    addValue(bounds, boundsX, newNumber(window->bounds.origin.x));
+    addValue(bounds, boundsY, newNumber(window->bounds.origin.y));
+    addValue(bounds, boundsWidth, newNumber(window->bounds.size.width));
+    addValue(bounds, boundsHeight, newNumber(window->bounds.size.height));
+
+    dict = newDictionary(6);
+    addValue(dict, kCGWindowNumber, newNumber(window->id));
+    addValue(dict, kCGWindowOwnerPID, newNumber(window->pid));
+    addValue(dict, kCGWindowLayer, newNumber(window->layer));
+    addValue(dict, kCGWindowBounds, bounds);
+    if(window->appName) {
+        addValue(dict, kCGWindowOwnerName, newString(window->appName));
+    }
+    if(window->windowName &&
+       (atomic_load(&authorized) || window->pid == getpid()))
+    {
+        addValue(dict, kCGWindowName, newString(window->windowName));
+    }
+    return dict;
+}
+
+/* Window at index i, made up in scratch and name if windows are
+ * synthetic; call with lock held
+ */
+static const MockWindow *windowAt(
+    int i,
+    MockWindow *scratch,
+    char name[GENERATED_NAME_SIZE]
+) {
+    if(!numSynthetic) return &windows[i];
+    generateWindow(i, syntheticApps, scratch, name);
+    return scratch;
+}
+
+/* Number of windows, stored or synthetic; call with lock held */
+static int totalWindows() {
+    return numSynthetic ? numSynthetic : numWindows;
+}
+
+/* Index of window with given ID, or -1 if none; call with lock held */
+static int indexOfWindow(CGWindowID id) {
+    int i;
+
+    if(numSynthetic) {
+        return id >= 100 && id < 100 + (CGWindowID)numSynthetic ?
+            (int)(id - 100) : -1;
+    }
+    for(i = 0; i < numWindows; i++) {
+        if(windows[i].id == id) return i;
+    }
+    return -1;
+}
+
+/* Return true if window at index i is selected by list options, relative
+ * to the window at index relativeIndex (-1 if none)
+ */
+static int isListed(
+    const MockWindow *window,
+    int i,
+    CGWindowListOption option,
+    int relativeIndex
+) {
+    if((option & kCGWindowListExcludeDesktopElements) && window->layer < 0) {
+        return 0;
+    }
+    if(option & kCGWindowListOptionIncludingWindow) {
+        if(i == relativeIndex) return 1;
+        if(!(option & (kCGWindowListOptionOnScreenAboveWindow|
+                       kCGWindowListOptionOnScreenBelowWindow)))
+        {
+            return 0;
+        }
+    }
+    if(option & (kCGWindowListOptionOnScreenOnly|
+                 kCGWindowListOptionOnScreenAboveWindow|
+                 kCGWindowListOptionOnScreenBelowWindow))
+    {
+        if(!window->onScreen) return 0;
+    }
+    if((option & kCGWindowListOptionOnScreenAboveWindow) &&
+       !(relativeIndex >= 0 && i < relativeIndex))
+    {
+        return 0;
+    }
+    if((option & kCGWindowListOptionOnScreenBelowWindow) &&
+       !(relativeIndex >= 0 && i > relativeIndex))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/* Indexes of windows selected by option, front to back, into indexes
+ * with room for totalWindows(); call with lock held
+ */
+static int listWindows(
+    CGWindowListOption option,
+    CGWindowID relativeToWindow,
+    int *indexes
+) {
+    MockWindow scratch;
+    char name[GENERATED_NAME_SIZE];
+    int i, count, total, relativeIndex;
+
+    relativeIndex = indexOfWindow(relativeToWindow);
+    total = totalWindows();
+    for(i = count = 0; i < total; i++) {
+        if(isListed(windowAt(i, &scratch, name), i, option, relativeIndex)) {
+            indexes[count++] = i;
+        }
+    }
+    return count;
+}
+
+CFArrayRef CGWindowListCopyWindowInfo(
+    CGWindowListOption option, CGWindowID relativeToWindow
+) {
+    const void **values;
+    MockWindow scratch;
+    char name[GENERATED_NAME_SIZE];
+    int *indexes, count, i;
+    CFArrayRef list;
+
+    initializeOnce();
+    atomic_fetch_add(&windowLists, 1);
+    pthread_mutex_lock(&lock);
+    indexes = (int *)malloc((totalWindows() + 1) * sizeof(int));
+    values = (const void **)malloc((totalWindows() + 1) * sizeof(void *));
+    count = listWindows(option, relativeToWindow, indexes);
+    for(i = 0; i < count; i++) {
+        values[i] = describeWindow(windowAt(indexes[i], &scratch, name));
+    }
+    pthread_mutex_unlock(&lock);
+    list = newArray(values, count, 1);
+    free(values);
+    free(indexes);
+
+    return handOut(list);
+}
+
+CFArrayRef CGWindowListCreate(
+    CGWindowListOption option, CGWindowID relativeToWindow
+) {
+    const void **values;
+    int *indexes, count, i;
+    CFArrayRef list;
+
+    initializeOnce();
+    atomic_fetch_add(&windowLists, 1);
+    pthread_mutex_lock(&lock);
+    indexes = (int *)malloc((totalWindows() + 1) * sizeof(int));
+    values = (const void **)malloc((totalWindows() + 1) * sizeof(void *));
+    count = listWindows(option, relativeToWindow, indexes);
+    for(i = 0; i < count; i++) {
+        values[i] = (const void *)(uintptr_t)(
+            numSynthetic ? 100 + indexes[i] : windows[indexes[i]].id
+        );
+    }
+    pthread_mutex_unlock(&lock);
+    list = newArray(values, count, 0);
+    free(values);
+    free(indexes);
+
+    return handOut(list);
+}
+
+CFArrayRef CGWindowListCreateDescriptionFromArray(CFArrayRef windowArray) {
+    const void **values;
+    MockWindow scratch;
+    char name[GENERATED_NAME_SIZE];
+    CFIndex i;
+    int j, count;
+    CFArrayRef list;
+
+    initializeOnce();
+    atomic_fetch_add(&windowLists, 1);
+    values = (const void **)malloc((windowArray->count + 1) * sizeof(void *));
+    pthread_mutex_lock(&lock);
+    for(i = count = 0; i < windowArray->count; i++) {
+        j = indexOfWindow((CGWindowID)(uintptr_t)windowArray->values[i]);
+        if(j != -1) {
+            values[count++] = describeWindow(windowAt(j, &scratch, name));
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    list = newArray(values, count, 1);
+    free(values);
+
+    return handOut(list);
+}
+
+/* The probe only checks whether a stream can be made */
+CGDisplayStreamRef CGDisplayStreamCreate(
+    CGDirectDisplayID display, size_t outputWidth, size_t outputHeight,
+    int32_t pixelFormat, CFDictionaryRef properties,
+    CGDisplayStreamFrameAvailableHandler handler
+) {
+    initializeOnce();
+    atomic_fetch_add(&probes, 1);
+    if(atomic_load(&probeUsec) > 0) usleep(atomic_load(&probeUsec));
+    if(!atomic_load(&authorized)) return NULL;
+    return handOut(newObject(
+        MOCK_DISPLAY_STREAM, sizeof(struct __CGDisplayStream)
+    ));
+}
+
+Boolean AXIsProcessTrusted(void) {
+    return 1;
+}
+
+static struct __AXUIElement *newElement(pid_t pid, CGWindowID windowId) {
+    struct __AXUIElement *element = (struct __AXUIElement *)newObject(
+        MOCK_AX_ELEMENT, sizeof(struct __AXUIElement)
+    );
+    element->pid = pid;
+    element->windowId = windowId;
+    return element;
+}
+
+AXUIElementRef AXUIElementCreateApplication(pid_t pid) {
+    initializeOnce();
+    return handOut(newElement(pid, 0));
+}
+
+/* Undocumented API movewin uses to match windows by ID */
+AXError _AXUIElementGetWindow(AXUIElementRef element, CGWindowID *out) {
+    if(!element->windowId) return kAXErrorFailure;
+    *out = element->windowId;
+    return kAXErrorSuccess;
+}
+
+/* Count a kAXWindowsAttribute copy against its application */
+static void countAppWindowList(pid_t pid) {
+    int i;
+
+    atomic_fetch_add(&appWindowLists, 1);
+    for(i = 0; i < numApps && apps[i].pid != pid; i++);
+    if(i == numApps) {
+        if(numApps == MAX_APPS) return;
+        apps[numApps].pid = pid;
+        apps[numApps++].windowLists = 0;
+    }
+    apps[i].windowLists++;
+}
+
+static MockWindow *findWindow(CGWindowID id) {
+    int i;
+    for(i = 0; i < numWindows; i++) {
+        if(windows[i].id == id) return &windows[i];
+    }
+    return NULL;
+}
+
+AXError AXUIElementCopyAttributeValue(
+    AXUIElementRef element, CFStringRef attribute, CFTypeRef *value
+) {
+    struct __AXValue *axValue;
+    const void **values;
+    MockWindow *window;
+    AXError error = kAXErrorSuccess;
+    int i, count;
+
+    *value = NULL;
+    if(atomic_load(&axUsec) > 0 && attribute == kAXWindowsAttribute) {
+        usleep(atomic_load(&axUsec));
+    }
+    pthread_mutex_lock(&lock);
+    window = element->windowId ? findWindow(element->windowId) : NULL;
+    if(!element->windowId && attribute == kAXWindowsAttribute) {
+        countAppWindowList(element->pid);
+        values = (const void **)malloc((numWindows + 1) * sizeof(void *));
+        for(i = count = 0; i < numWindows; i++) {
+            if(windows[i].pid == element->pid && windows[i].layer == 0) {
+                values[count++] = newElement(element->pid, windows[i].id);
+            }
+        }
+        *value = newArray(values, count, 1);
+        free(values);
+    } else if(window && attribute == kAXTitleAttribute) {
+        *value = window->windowName ? newString(window->windowName) : NULL;
+    } else if(window && (attribute == kAXPositionAttribute ||
+                         attribute == kAXSizeAttribute))
+    {
+        axValue = (struct __AXValue *)newObject(
+            MOCK_AX_VALUE, sizeof(struct __AXValue)
+        );
+        axValue->type = attribute == kAXPositionAttribute ?
+            kAXValueCGPointType : kAXValueCGSizeType;
+        axValue->point = window->bounds.origin;
+        axValue->size = window->bounds.size;
+        *value = axValue;
+    } else {
+        error = kAXErrorAttributeUnsupported;
+    }
+    pthread_mutex_unlock(&lock);
+
+    handOut(*value);
+    return error;
+}
+
+AXError AXUIElementSetAttributeValue(
+    AXUIElementRef element, CFStringRef attribute, CFTypeRef value
+) {
+    AXValueRef axValue = (AXValueRef)value;
+    MockWindow *window;
+    AXError error = kAXErrorSuccess;
+
+    atomic_fetch_add(&attributeSets, 1);
+    if(atomic_load(&axUsec) > 0) usleep(atomic_load(&axUsec));
+    pthread_mutex_lock(&lock);
+    window = element->windowId ? findWindow(element->windowId) : NULL;
+    if(!window || !axValue) {
+        error = kAXErrorFailure;
+    } else if(attribute == kAXPositionAttribute &&
+              axValue->type == kAXValueCGPointType)
+    {
+        window->bounds.origin = axValue->point;
+    } else if(attribute == kAXSizeAttribute &&
+              axValue->type == kAXValueCGSizeType)
+    {
+        window->bounds.size = axValue->size;
+    } else {
+        error = kAXErrorAttributeUnsupported;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return error;
+}
+
+AXValueRef AXValueCreate(AXValueType type, const void *valuePtr) {
+    struct __AXValue *value = (struct __AXValue *)newObject(
+        MOCK_AX_VALUE, sizeof(struct __AXValue)
+    );
+    value->type = type;
+    if(type == kAXValueCGPointType) value->point = *(const CGPoint *)valuePtr;
+    if(type == kAXValueCGSizeType) value->size = *(const CGSize *)valuePtr;
+    return handOut(value);
+}
+
+Boolean AXValueGetValue(AXValueRef value, AXValueType type, void *valuePtr) {
+    if(value->type != type) return 0;
+    if(type == kAXValueCGPointType) *(CGPoint *)valuePtr = value->point;
+    if(type == kAXValueCGSizeType) *(CGSize *)valuePtr = value->size;
+    return 1;
+}
+
+AXValueType AXValueGetType(AXValueRef value) {
+    return value->type;
+}
+
+
+/* ======================================================================== */
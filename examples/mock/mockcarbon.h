@@ -0,0 +1,127 @@
+/* ========================================================================
+ * mockcarbon.h - control and inspect the synthetic window server
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef MOCKCARBON_H
+#define MOCKCARBON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <Carbon/Carbon.h>
+
+/* One window of the synthetic window server */
+typedef struct {
+    CGWindowID id;
+    pid_t pid;
+    int layer;
+    int onScreen;
+    CGRect bounds;
+    const char *appName;      /* kCGWindowOwnerName, NULL for none */
+    const char *windowName;   /* kCGWindowName, NULL for none */
+} MockWindow;
+
+/* Replace every window, in front to back order; strings are copied.
+ * Until this is called, there are $MOCKCARBON_WINDOWS windows (default
+ * 12) spread over $MOCKCARBON_APPS applications (default 4).
+ */
+void MockCarbonSetWindows(const MockWindow *windows, int count);
+
+/* Replace every window with count generated ones, spread round robin
+ * over numApps applications with PIDs from 1000 up
+ */
+void MockCarbonMakeWindows(int count, int numApps);
+
+/* Replace every window with count generated ones as above, except that
+ * they are made up each time they are listed or described rather than
+ * stored, so the mock's memory does not grow with count; they cannot be
+ * looked up with MockCarbonGetWindow() or moved
+ */
+void MockCarbonMakeSyntheticWindows(int count, int numApps);
+
+/* Copy current state of window with given ID, return -1 if none */
+int MockCarbonGetWindow(CGWindowID id, MockWindow *window);
+
+/* Grant or revoke screen recording permission ($MOCKCARBON_UNAUTHORIZED
+ * revokes it at startup); without it the probe fails and window names
+ * of other processes are left out of window lists, as on macOS
+ */
+void MockCarbonSetAuthorized(int authorized);
+
+/* Make the screen recording probe, and every accessibility call that
+ * lists or changes windows, take this long ($MOCKCARBON_PROBE_USEC and
+ * $MOCKCARBON_AX_USEC, default 0)
+ */
+void MockCarbonSetLatency(int probeUsec, int axUsec);
+
+/* Calls made, and CF references handed out and given back, since the
+ * last reset. References are counted from the caller's side: every
+ * Create or Copy function hands out one, as does CFRetain(), and
+ * CFRelease() gives one back, so a caller that balances its ownership
+ * leaves owned + retained - released unchanged.
+ */
+typedef struct {
+    long owned;               /* objects returned by Create or Copy calls */
+    long retained;            /* CFRetain() calls */
+    long released;            /* CFRelease() calls */
+    long windowLists;         /* CGWindowList*() calls */
+    long probes;              /* CGDisplayStreamCreate() calls */
+    long appWindowLists;      /* kAXWindowsAttribute copies, every app */
+    long attributeSets;       /* AXUIElementSetAttributeValue() calls */
+} MockCarbonCounts;
+
+void MockCarbonGetCounts(MockCarbonCounts *counts);
+void MockCarbonResetCounts(void);
+
+/* Number of times kAXWindowsAttribute was copied for one application */
+long MockCarbonAppWindowLists(pid_t pid);
+
+/* Number of mock CF objects currently allocated, constants excluded */
+long MockCarbonLiveObjects(void);
+
+/* Heap blocks allocated and not freed, counted by mockalloc.c, which only
+ * programs that count allocations link in
+ */
+long MockAllocLiveBlocks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !MOCKCARBON_H */
+
+
+/* ======================================================================== */
@@ -0,0 +1,281 @@
+/* ========================================================================
+ * movecalls.c - count accessibility calls movewin makes per application
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <fcntl.h>
+#include "mockcarbon.h"
+#include "winclaim.h"
+#include "winshm.h"
+
+/* Built only in examples/mock, which links in movewin.c with its main()
+ * renamed to movewin_main(), so a whole movewin run goes through
+ * MoveWindows() against the mock window server
+ */
+#define ME "movecalls"
+#define APPS 6
+#define WINDOWS_PER_APP 4
+#define IN_PLACE_PID 1002   /* application whose windows need not move */
+#define JOURNAL_HEAD_OFFSET 16  /* of uint64_t head, then cursor, on disk */
+
+int movewin_main(int argc, char **argv);
+
+/* Run movewin with a NULL terminated list of arguments */
+static int runMovewin(char **argv) {
+    int argc;
+
+    for(argc = 0; argv[argc]; argc++);
+    optind = 1;
+    return movewin_main(argc, argv);
+}
+
+/* Return number of windows not where makeWindows() put them, or if moved,
+ * not stacked at 40,60 as movewin -a -o 0,0 Window 40 60 leaves them
+ */
+static int countMisplaced(int moved) {
+    MockWindow window;
+    CGPoint expected;
+    int i, misplaced = 0;
+
+    for(i = 0; i < APPS * WINDOWS_PER_APP; i++) {
+        expected = (moved || 1000 + i % APPS == IN_PLACE_PID) ?
+            CGPointMake(40, 60) : CGPointMake(100 + 10 * i, 100 + 10 * i);
+        if(MockCarbonGetWindow(100 + i, &window) != 0 ||
+           !CGPointEqualToPoint(window.bounds.origin, expected))
+        {
+            misplaced++;
+        }
+    }
+
+    return misplaced;
+}
+
+/* Set head of journal at path one short of its cursor, which an undo
+ * that trusted the header would walk back from into the last run
+ */
+static int corruptJournal(const char *path) {
+    uint64_t header[2];
+    int fd, ok;
+
+    fd = open(path, O_RDWR);
+    if(fd == -1) return 0;
+    ok = pread(fd, header, sizeof(header), JOURNAL_HEAD_OFFSET) ==
+        sizeof(header);
+    header[0] = header[1] - 1;
+    ok = ok && pwrite(fd, header, sizeof(header), JOURNAL_HEAD_OFFSET) ==
+        sizeof(header);
+    close(fd);
+
+    return ok;
+}
+
+/* Lay out APPS applications with WINDOWS_PER_APP windows each, all
+ * cascaded except those of IN_PLACE_PID, which are already at 40,60
+ */
+static void makeWindows() {
+    MockWindow windows[APPS * WINDOWS_PER_APP];
+    char names[APPS * WINDOWS_PER_APP][32];
+    int i;
+
+    for(i = 0; i < APPS * WINDOWS_PER_APP; i++) {
+        snprintf(names[i], sizeof(names[i]), "Window %d", i);
+        windows[i].id = 100 + i;
+        windows[i].pid = 1000 + i % APPS;
+        windows[i].layer = 0;
+        windows[i].onScreen = 1;
+        windows[i].bounds = windows[i].pid == IN_PLACE_PID ?
+            CGRectMake(40, 60, 800, 600) :
+            CGRectMake(100 + 10 * i, 100 + 10 * i, 800, 600);
+        windows[i].appName = "App";
+        windows[i].windowName = names[i];
+    }
+    MockCarbonSetWindows(windows, APPS * WINDOWS_PER_APP);
+}
+
+/* Return true, complaining if not, if window id has frame x y width height */
+static int expectWindow(
+    const char *what, CGWindowID id,
+    CGFloat x, CGFloat y, CGFloat width, CGFloat height
+) {
+    MockWindow window;
+
+    if(MockCarbonGetWindow(id, &window) == 0 &&
+       CGRectEqualToRect(window.bounds, CGRectMake(x, y, width, height)))
+    {
+        return 1;
+    }
+    fprintf(stderr, ME ": %s: window %u not at %.0f,%.0f %.0fx%.0f\n",
+            what, (unsigned int)id, x, y, width, height);
+    return 0;
+}
+
+/* Check movewin --snap and --snap-resize on a display 1440x900, as the
+ * mock has; return number of failed checks
+ */
+static int checkSnap() {
+    MockWindow windows[] = {
+        { 200, 2000, 0, 1, { { 1000, 100 }, { 200, 200 } }, "App", "Snap 0" },
+        { 201, 2000, 0, 1, { { 100, 600 }, { 200, 200 } }, "App", "Snap 1" },
+        { 202, 2001, 0, 1, { { 10, 650 }, { 1420, 100 } }, "App", "Edges" }
+    };
+    char *snapArgv[] = {
+        "movewin", "--snap", "-a", "-o", "210,0", "Snap", "300", "300", NULL
+    };
+    char *moveArgv[] = { "movewin", "--snap", "-i", "202", NULL };
+    char *resizeArgv[] = { "movewin", "--snap-resize", "-i", "202", NULL };
+    int failed = 0;
+
+    /* Snap 0 goes to 300,300, then Snap 1 to 510,300 snaps to where Snap 0
+     * now ends at x 500, not to where it was before moving
+     */
+    MockCarbonSetWindows(windows, 2);
+    runMovewin(snapArgv);
+    failed += !expectWindow("--snap -a", 200, 300, 300, 200, 200);
+    failed += !expectWindow("--snap -a", 201, 500, 300, 200, 200);
+
+    /* Both sides are 10 from the display edges: moving takes the left one
+     * and keeps the size, resizing takes both
+     */
+    MockCarbonSetWindows(windows, 3);
+    runMovewin(moveArgv);
+    failed += !expectWindow("--snap", 202, 0, 650, 1420, 100);
+    MockCarbonSetWindows(windows, 3);
+    runMovewin(resizeArgv);
+    failed += !expectWindow("--snap-resize", 202, 0, 650, 1440, 100);
+
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    char *moveArgv[] = {
+        "movewin", "-a", "-o", "0,0", "Window", "40", "60", NULL
+    };
+    char *undoArgv[] = { "movewin", "--undo", NULL };
+    char *redoArgv[] = { "movewin", "--redo", NULL };
+    MockCarbonCounts counts;
+    char dir[] = "/tmp/movecallsXXXXXX", path[64], claims[64];
+    long lists, expected;
+    pid_t pid;
+    int failed = 0;
+
+    /* Keep the journal, claim table, and authorization cache out of the
+     * user's way
+     */
+    if(!mkdtemp(dir)) {
+        perror(ME ": mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/journal", dir);
+    setenv("MOVEWIN_JOURNAL", path, 1);
+    setenv("TMPDIR", dir, 1);
+    snprintf(claims, sizeof(claims), "/movecalls.%d", (int)getpid());
+    setenv(WINCLAIM_ENV, claims, 1);
+
+    makeWindows();
+    MockCarbonResetCounts();
+    if(runMovewin(moveArgv) != 0) {
+        fprintf(stderr, ME ": movewin failed\n");
+        failed = 1;
+    }
+    MockCarbonGetCounts(&counts);
+
+    /* Each application with a window to move has its window list copied
+     * exactly once, and one whose windows are all in place not at all
+     */
+    for(pid = 1000; pid < 1000 + APPS; pid++) {
+        lists = MockCarbonAppWindowLists(pid);
+        expected = pid == IN_PLACE_PID ? 0 : 1;
+        printf("pid %d: %ld window list copies\n", (int)pid, lists);
+        if(lists != expected) {
+            fprintf(stderr, ME ": pid %d copied window list %ld times, "
+                    "expected %ld\n", (int)pid, lists, expected);
+            failed = 1;
+        }
+    }
+    if(counts.appWindowLists != APPS - 1) {
+        fprintf(stderr, ME ": %ld window list copies in all, expected %d\n",
+                counts.appWindowLists, APPS - 1);
+        failed = 1;
+    }
+
+    /* And every window did end up in place */
+    if(countMisplaced(1) > 0) {
+        fprintf(stderr, ME ": %d windows not moved\n", countMisplaced(1));
+        failed = 1;
+    }
+    printf("%d windows of %d applications, %ld window list copies, "
+           "%ld attribute sets\n", APPS * WINDOWS_PER_APP, APPS,
+           counts.appWindowLists, counts.attributeSets);
+
+    /* One undo puts back every window that run moved, one redo all again */
+    runMovewin(undoArgv);
+    if(countMisplaced(0) > 0) {
+        fprintf(stderr, ME ": %d windows not put back by --undo\n",
+                countMisplaced(0));
+        failed = 1;
+    }
+    runMovewin(redoArgv);
+    if(countMisplaced(1) > 0) {
+        fprintf(stderr, ME ": %d windows not moved again by --redo\n",
+                countMisplaced(1));
+        failed = 1;
+    }
+
+    /* A journal with a bad header is started over, leaving nothing to undo */
+    if(!corruptJournal(path)) {
+        fprintf(stderr, ME ": unable to rewrite journal header\n");
+        failed = 1;
+    }
+    runMovewin(undoArgv);
+    if(countMisplaced(1) > 0) {
+        fprintf(stderr, ME ": %d windows moved by --undo of a bad journal\n",
+                countMisplaced(1));
+        failed = 1;
+    }
+
+    /* Snapping, to other windows and to the display */
+    if(checkSnap() > 0) failed = 1;
+
+    WinShmUnlink(claims);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/movewin-auth-%u", dir,
+             (unsigned int)getuid());
+    unlink(path);
+    rmdir(dir);
+
+    return failed;
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,224 @@
+/* ========================================================================
+ * shmbench.c - time shared memory publishes against concurrent reads
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "winshm.h"
+#include "mockcarbon.h"
+
+/* Built in examples/mock only: the windows published come from the mock
+ * window server, so one process can play lswin -p and its readers
+ */
+#define ME "shmbench"
+#define USAGE "usage: " ME " [-h] [-r readers] [-s secs] [-w windows]\n"
+#define FULL_USAGE USAGE \
+    "    -h          display this help text and exit\n" \
+    "    -r readers  reader threads (default 4)\n" \
+    "    -s secs     how long to run (default 1)\n" \
+    "    -w windows  windows to publish (default 200)\n"
+#define REGION_NAME "/movewin.shmbench"
+#define MAX_READERS 64
+
+/* Shared between the publisher and reader threads */
+typedef struct {
+    WinShmRegion *region;
+    int windows;
+    atomic_int done;
+    long reads, failed, inconsistent;
+} Reader;
+
+/* Return monotonic time in seconds */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Sort times in ascending order */
+static int compareTimes(const void *a, const void *b) {
+    double timeA = *(const double *)a, timeB = *(const double *)b;
+    return (timeA > timeB) - (timeA < timeB);
+}
+
+/* Take snapshots until told to stop, checking each is a whole publish:
+ * every window there, generations never going backwards, and every
+ * title matching the mock's "app - name" of that window
+ */
+static void *readLoop(void *readerPtr) {
+    Reader *reader = (Reader *)readerPtr;
+    WinShmTable *table = (WinShmTable *)malloc(sizeof(WinShmTable));
+    MockWindow window;
+    uint64_t lastGeneration = 0;
+    char title[256];
+    uint32_t i;
+
+    while(!atomic_load(&reader->done)) {
+        if(WinShmRead(reader->region, table) != 0) {
+            reader->failed++;
+            continue;
+        }
+        reader->reads++;
+        if(table->count != (uint32_t)reader->windows ||
+           table->generation < lastGeneration)
+        {
+            reader->inconsistent++;
+            continue;
+        }
+        lastGeneration = table->generation;
+        for(i = 0; i < table->count; i += 17) {
+            if(MockCarbonGetWindow(table->records[i].id, &window) != 0) {
+                reader->inconsistent++;
+                break;
+            }
+            snprintf(
+                title, sizeof(title), "%s - %s",
+                window.appName, window.windowName
+            );
+            if(strcmp(WinShmString(table, table->records[i].title), title)) {
+                reader->inconsistent++;
+                break;
+            }
+        }
+    }
+    free(table);
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    Reader readers[MAX_READERS];
+    pthread_t threads[MAX_READERS];
+    WinShmPublisher *publisher;
+    double seconds = 1, start, end, *times;
+    long publishes, capacity, reads, failed, inconsistent;
+    int ch, i, numReaders = 4, windows = 200;
+
+#define DIE(msg) { fprintf(stderr, ME ": " msg "\n"); exit(1); }
+#define DIE_OPT(msg) \
+    { fprintf(stderr, ME ": " msg " -- %c\n" USAGE, optopt); return 1; }
+
+    while((ch = getopt(argc, argv, ":hr:s:w:")) != -1) {
+        switch(ch) {
+            case 'h':
+                printf(FULL_USAGE);
+                return 0;
+            case 'r':
+                numReaders = atoi(optarg);
+                if(numReaders < 0 || numReaders > MAX_READERS) {
+                    DIE("readers must be from 0 to 64");
+                }
+                break;
+            case 's':
+                seconds = atof(optarg);
+                if(seconds <= 0) DIE("secs must be positive");
+                break;
+            case 'w':
+                windows = atoi(optarg);
+                if(windows <= 0 || windows > WINSHM_MAX_WINDOWS) {
+                    DIE("windows must be from 1 to 1024");
+                }
+                break;
+            case ':':
+                DIE_OPT("option requires an argument");
+            default:
+                DIE_OPT("illegal option");
+        }
+    }
+
+    /* One app, so that every window is on the normal layer and listed */
+    MockCarbonMakeWindows(windows, 1);
+    WinShmUnlink(REGION_NAME);
+    publisher = WinShmPublisherOpen(REGION_NAME);
+    if(!publisher) DIE("unable to open region for publishing");
+    if(WinShmPublish(publisher, NULL) != windows) {
+        DIE("published a different number of windows than listed");
+    }
+
+    /* Readers map the region themselves, as separate processes would */
+    for(i = 0; i < numReaders; i++) {
+        memset(&readers[i], 0, sizeof(Reader));
+        readers[i].region = WinShmOpen(REGION_NAME, 0);
+        if(!readers[i].region) DIE("unable to open region for reading");
+        readers[i].windows = windows;
+        pthread_create(&threads[i], NULL, readLoop, (void *)&readers[i]);
+    }
+
+    capacity = 1024;
+    times = (double *)malloc(capacity * sizeof(double));
+    publishes = 0;
+    end = now() + seconds;
+    while((start = now()) < end) {
+        WinShmPublish(publisher, NULL);
+        if(publishes == capacity) {
+            capacity *= 2;
+            times = (double *)realloc(times, capacity * sizeof(double));
+        }
+        times[publishes++] = now() - start;
+    }
+
+    reads = failed = inconsistent = 0;
+    for(i = 0; i < numReaders; i++) {
+        atomic_store(&readers[i].done, 1);
+        pthread_join(threads[i], NULL);
+        reads += readers[i].reads;
+        failed += readers[i].failed;
+        inconsistent += readers[i].inconsistent;
+        WinShmClose(readers[i].region);
+    }
+
+    qsort(times, publishes, sizeof(double), compareTimes);
+    printf(
+        "%d windows: %.0f publishes/s (p50 %.1f us, p99 %.1f us), "
+        "%d readers: %.0f reads/s each, %ld failed, %ld inconsistent\n",
+        windows, publishes / seconds, times[publishes / 2] * 1e6,
+        times[publishes * 99 / 100] * 1e6, numReaders,
+        numReaders ? reads / seconds / numReaders : 0.0, failed,
+        inconsistent
+    );
+
+    free(times);
+    WinShmPublisherClose(publisher);
+    WinShmUnlink(REGION_NAME);
+
+    return failed || inconsistent ? 1 : 0;
+
+#undef DIE_OPT
+#undef DIE
+}
+
+
+/* ======================================================================== */
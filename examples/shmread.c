@@ -0,0 +1,126 @@
+/* ========================================================================
+ * shmread.c - read the window table published by lswin -p
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sys/time.h>
+#include "winshm.h"
+
+#define ME "shmread"
+#define USAGE "usage: " ME " [-h] [-n reads] [name]\n"
+#define FULL_USAGE USAGE \
+    "    -h        display this help text and exit\n" \
+    "    -n reads  take this many snapshots and report throughput\n" \
+    "    name      shared memory region (default " WINSHM_DEFAULT_NAME ")\n"
+
+/* Return current time in seconds */
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char **argv) {
+    WinShmRegion *region;
+    WinShmTable *table;
+    WinShmRecord *record;
+    const char *name = WINSHM_DEFAULT_NAME;
+    uint64_t firstGeneration;
+    double start, elapsed;
+    int ch, i, reads = 0;
+
+#define DIE(msg) { fprintf(stderr, ME ": " msg "\n"); exit(1); }
+#define DIE_OPT(msg) \
+    { fprintf(stderr, ME ": " msg " -- %c\n" USAGE, optopt); return 1; }
+
+    while((ch = getopt(argc, argv, ":hn:")) != -1) {
+        switch(ch) {
+            case 'h':
+                printf(FULL_USAGE);
+                return 0;
+            case 'n':
+                reads = atoi(optarg);
+                break;
+            case ':':
+                DIE_OPT("option requires an argument");
+            default:
+                DIE_OPT("illegal option");
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if(argc > 0) name = argv[0];
+
+    region = WinShmOpen(name, 0);
+    if(!region) DIE("unable to open shared memory region");
+    table = (WinShmTable *)malloc(sizeof(WinShmTable));
+
+    /* Print the current table, in the same format as lswin -l */
+    if(reads <= 0) {
+        if(WinShmRead(region, table) != 0) DIE("invalid or stuck region");
+        for(i = 0; i < table->count; i++) {
+            record = &table->records[i];
+            printf(
+                "%u - %s - %d %d %d %d\n", record->id,
+                WinShmString(table, record->title),
+                record->x, record->y, record->width, record->height
+            );
+        }
+
+    /* Otherwise, take snapshots in a loop and report how fast that was */
+    } else {
+        if(WinShmRead(region, table) != 0) DIE("invalid or stuck region");
+        firstGeneration = table->generation;
+        start = now();
+        for(i = 0; i < reads; i++) WinShmRead(region, table);
+        elapsed = now() - start;
+        printf(
+            "%d reads of %u windows in %.3fs, %.0f reads/s, "
+            "%llu publishes seen\n",
+            reads, table->count, elapsed, reads / elapsed,
+            (unsigned long long)(table->generation - firstGeneration)
+        );
+    }
+
+    free(table);
+    WinShmClose(region);
+
+    return 0;
+
+#undef DIE_OPT
+#undef DIE
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,266 @@
+/* ========================================================================
+ * snapbench.c - check and time edge snapping against a linear scan
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sys/time.h>
+#include "winsnap.h"
+
+#define WINDOWS 5000
+#define QUERIES 100000
+#define TOLERANCE 16
+
+/* Return current time in seconds */
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Random window frame on a 5120x2880 desktop */
+static CGRect randomFrame() {
+    return CGRectMake(
+        random() % 5120, random() % 2880,
+        100 + random() % 1200, 100 + random() % 900
+    );
+}
+
+/* WinSnapFindEdge() the slow way, by looking at every frame */
+static int findEdgeLinear(
+    const CGRect *frames, const CGWindowID *ids, int count,
+    int vertical, CGFloat at, CGFloat from, CGFloat to,
+    CGWindowID exclude, CGFloat tolerance, CGFloat *edge
+) {
+    CGFloat edges[2], edgeFrom, edgeTo, distance, best = 0;
+    int i, e, found = 0;
+
+    for(i = 0; i < count; i++) {
+        if(ids[i] == exclude) continue;
+        if(vertical) {
+            edges[0] = CGRectGetMinX(frames[i]);
+            edges[1] = CGRectGetMaxX(frames[i]);
+            edgeFrom = CGRectGetMinY(frames[i]);
+            edgeTo = CGRectGetMaxY(frames[i]);
+        } else {
+            edges[0] = CGRectGetMinY(frames[i]);
+            edges[1] = CGRectGetMaxY(frames[i]);
+            edgeFrom = CGRectGetMinX(frames[i]);
+            edgeTo = CGRectGetMaxX(frames[i]);
+        }
+        if(edgeFrom > to + tolerance || edgeTo < from - tolerance) continue;
+        for(e = 0; e < 2; e++) {
+            distance = fabs(edges[e] - at);
+            if(distance > tolerance) continue;
+            if(!found || distance < best ||
+               (distance == best && edges[e] < *edge))
+            {
+                best = distance;
+                *edge = edges[e];
+                found = 1;
+            }
+        }
+    }
+
+    return found;
+}
+
+/* Return true, complaining if not, if frame is x y width height */
+static int expectFrame(
+    const char *what, CGRect frame,
+    CGFloat x, CGFloat y, CGFloat width, CGFloat height
+) {
+    if(CGRectEqualToRect(frame, CGRectMake(x, y, width, height))) return 1;
+    fprintf(
+        stderr, "snapbench: %s: got %.0f,%.0f %.0fx%.0f, "
+        "expected %.0f,%.0f %.0fx%.0f\n", what,
+        frame.origin.x, frame.origin.y, frame.size.width, frame.size.height,
+        x, y, width, height
+    );
+    return 0;
+}
+
+/* Check WinSnapFrame() moving and resizing against two known windows,
+ * and after one of them moves; return number of failed checks
+ */
+static int checkSnapFrame() {
+    CGRect frames[2] = {
+        CGRectMake(0, 0, 100, 100), CGRectMake(300, 0, 100, 100)
+    };
+    CGWindowID ids[2] = { 1, 2 };
+    WinSnapIndex *index;
+    CGRect frame;
+    int failed = 0;
+
+    index = WinSnapIndexCreate(frames, ids, 2);
+
+    /* Left edge is 5 from window 1, right edge 10 from window 2; moving
+     * keeps the size and takes the nearer, resizing takes both
+     */
+    frame = CGRectMake(105, 40, 185, 20);
+    failed += !expectFrame(
+        "move", WinSnapFrame(index, 3, frame, TOLERANCE, 0), 100, 40, 185, 20
+    );
+    failed += !expectFrame(
+        "resize", WinSnapFrame(index, 3, frame, TOLERANCE, 1), 100, 40, 200, 20
+    );
+
+    /* A window never snaps to itself */
+    failed += !expectFrame(
+        "exclude", WinSnapFrame(index, 1, CGRectMake(5, 5, 90, 90),
+                                TOLERANCE, 0),
+        5, 5, 90, 90
+    );
+
+    /* Nor to edges further than tolerance, or beside it but out of line */
+    failed += !expectFrame(
+        "far", WinSnapFrame(index, 3, CGRectMake(120, 40, 150, 20),
+                            TOLERANCE, 1),
+        120, 40, 150, 20
+    );
+    failed += !expectFrame(
+        "out of line", WinSnapFrame(index, 3, CGRectMake(105, 200, 50, 50),
+                                    TOLERANCE, 0),
+        105, 200, 50, 50
+    );
+
+    /* Once window 2 moves away, only window 1 is left to resize to */
+    WinSnapIndexUpdate(index, 2, CGRectMake(1000, 0, 100, 100));
+    failed += !expectFrame(
+        "resize after update", WinSnapFrame(index, 3, frame, TOLERANCE, 1),
+        100, 40, 190, 20
+    );
+
+    /* Edges of a window new to the index are added */
+    WinSnapIndexUpdate(index, 4, CGRectMake(0, 95, 50, 50));
+    failed += !expectFrame(
+        "move after add", WinSnapFrame(index, 3, CGRectMake(60, 150, 20, 20),
+                                       TOLERANCE, 0),
+        50, 145, 20, 20
+    );
+
+    WinSnapIndexDestroy(index);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    CGRect *frames, *queries;
+    CGWindowID *ids, *excludes;
+    WinSnapIndex *index;
+    CGFloat edge, linearEdge, checksum;
+    int i, found, linearFound, mismatches, failed, vertical;
+    double start, indexTime, linearTime;
+
+    /* Known cases first */
+    failed = checkSnapFrame();
+    printf("%d snap frame checks failed\n", failed);
+
+    /* Random windows, and random frames to snap excluding one of them */
+    srandom(1);
+    frames = (CGRect *)malloc(WINDOWS * sizeof(CGRect));
+    ids = (CGWindowID *)malloc(WINDOWS * sizeof(CGWindowID));
+    for(i = 0; i < WINDOWS; i++) {
+        frames[i] = randomFrame();
+        ids[i] = i + 1;
+    }
+    queries = (CGRect *)malloc(QUERIES * sizeof(CGRect));
+    excludes = (CGWindowID *)malloc(QUERIES * sizeof(CGWindowID));
+    for(i = 0; i < QUERIES; i++) {
+        queries[i] = randomFrame();
+        excludes[i] = 1 + random() % WINDOWS;
+    }
+
+    start = now();
+    index = WinSnapIndexCreate(frames, ids, WINDOWS);
+    printf(
+        "indexed %d windows in %.2f ms\n", WINDOWS, (now() - start) * 1e3
+    );
+
+    /* Every lookup must agree with the linear scan */
+    mismatches = 0;
+    for(i = 0; i < QUERIES; i++) {
+        vertical = i & 1;
+        found = WinSnapFindEdge(
+            index, vertical,
+            vertical ? CGRectGetMinX(queries[i]) : CGRectGetMinY(queries[i]),
+            vertical ? CGRectGetMinY(queries[i]) : CGRectGetMinX(queries[i]),
+            vertical ? CGRectGetMaxY(queries[i]) : CGRectGetMaxX(queries[i]),
+            excludes[i], TOLERANCE, &edge
+        );
+        linearFound = findEdgeLinear(
+            frames, ids, WINDOWS, vertical,
+            vertical ? CGRectGetMinX(queries[i]) : CGRectGetMinY(queries[i]),
+            vertical ? CGRectGetMinY(queries[i]) : CGRectGetMinX(queries[i]),
+            vertical ? CGRectGetMaxY(queries[i]) : CGRectGetMaxX(queries[i]),
+            excludes[i], TOLERANCE, &linearEdge
+        );
+        if(found != linearFound || (found && edge != linearEdge)) mismatches++;
+    }
+    printf("%d of %d lookups differ from a linear scan\n", mismatches, QUERIES);
+
+    /* Time whole frame snaps, four lookups each */
+    checksum = 0;
+    start = now();
+    for(i = 0; i < QUERIES; i++) {
+        CGRect snapped = WinSnapFrame(
+            index, excludes[i], queries[i], TOLERANCE, i & 1
+        );
+        checksum += snapped.origin.x + snapped.size.height;
+    }
+    indexTime = now() - start;
+    start = now();
+    for(i = 0; i < QUERIES / 100; i++) {
+        CGRect q = queries[i];
+        findEdgeLinear(
+            frames, ids, WINDOWS, 1, CGRectGetMinX(q), CGRectGetMinY(q),
+            CGRectGetMaxY(q), excludes[i], TOLERANCE, &edge
+        );
+    }
+    linearTime = (now() - start) * 100;
+    printf(
+        "snap: %.0f ns/frame (4 lookups), linear scan: %.0f ns/lookup, "
+        "checksum %.0f\n",
+        indexTime * 1e9 / QUERIES, linearTime * 1e9 / QUERIES, checksum
+    );
+
+    WinSnapIndexDestroy(index);
+    free(frames);
+    free(ids);
+    free(queries);
+    free(excludes);
+
+    return (mismatches || failed) ? 1 : 0;
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,116 @@
+/* ========================================================================
+ * snapreaders.c - share window snapshots between many reader threads
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include "winsnapshot.h"
+#define ME "snapreaders"
+
+/* Build with CC_FLAGS="-Wall -I.. -fsanitize=thread" to check for races */
+#define READERS 16
+#define PUBLISHES 256
+#define PUBLISH_DELAY_MICROSEC 1000
+
+static WindowSnapshotSlot slot;
+static atomic_int done;
+
+/* Reader thread repeatedly looks up every window in the current snapshot */
+void *ReadSnapshots(void *lookupsPtr) {
+    long *lookups = (long *)lookupsPtr;
+    WindowSnapshot *snapshot;
+    const WindowInfo *info, *found;
+    int i;
+
+    while(!atomic_load(&done)) {
+        snapshot = WindowSnapshotSlotAcquire(&slot);
+        for(i = 0; i < WindowSnapshotGetCount(snapshot); i++) {
+            info = WindowSnapshotGetWindow(snapshot, i);
+            found = WindowSnapshotFindWindow(snapshot, info->id);
+            if(found != info || strlen(found->title) < strlen(found->appName)) {
+                fprintf(stderr, ME ": inconsistent snapshot\n");
+                exit(1);
+            }
+            (*lookups)++;
+        }
+        WindowSnapshotRelease(snapshot);
+    }
+
+    return NULL;
+}
+
+/* Publisher thread re-enumerates windows and swaps in the new snapshot */
+void *PublishSnapshots(void *unused) {
+    int i;
+
+    for(i = 0; i < PUBLISHES; i++) {
+        WindowSnapshotSlotPublish(&slot, WindowSnapshotCreate(NULL));
+        usleep(PUBLISH_DELAY_MICROSEC);
+    }
+    atomic_store(&done, 1);
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    pthread_t readers[READERS], publisher;
+    long lookups[READERS], total;
+    int i;
+
+    WindowSnapshotSlotInit(&slot);
+    WindowSnapshotSlotPublish(&slot, WindowSnapshotCreate(NULL));
+    atomic_init(&done, 0);
+
+    pthread_create(&publisher, NULL, PublishSnapshots, NULL);
+    for(i = 0; i < READERS; i++) {
+        lookups[i] = 0;
+        pthread_create(&readers[i], NULL, ReadSnapshots, (void *)&lookups[i]);
+    }
+
+    total = 0;
+    pthread_join(publisher, NULL);
+    for(i = 0; i < READERS; i++) {
+        pthread_join(readers[i], NULL);
+        total += lookups[i];
+    }
+    WindowSnapshotSlotDestroy(&slot);
+
+    printf(
+        "%d publishes, %d readers, %ld lookups\n", PUBLISHES, READERS, total
+    );
+
+    return 0;
+}
+
+
+/* ======================================================================== */
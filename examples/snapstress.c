@@ -0,0 +1,196 @@
+/* ========================================================================
+ * snapstress.c - check snapshot readers against the publish order
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sched.h>
+#include "winsnapshot.h"
+#define ME "snapstress"
+
+/* Unlike snapreaders, snapshots are made from WindowInfo arrays, so every
+ * window carries the generation of the snapshot it belongs to; built in
+ * examples/mock, which runs it under -fsanitize=thread
+ */
+#define READERS 16
+#define PUBLISHES 2000
+#define WINDOWS 8
+
+static WindowSnapshotSlot slot;
+static atomic_uint announced;  /* generation about to be published */
+static atomic_uint completed;  /* generation whose publish has returned */
+static atomic_int done;
+
+/* Number of windows in snapshot of generation */
+static int windowCount(unsigned int generation) {
+    return WINDOWS + generation % 5;
+}
+
+/* Snapshot of generation, stamped into the pid, ID, and names of each window */
+static WindowSnapshot *createGeneration(unsigned int generation) {
+    WindowInfo windows[WINDOWS + 5];
+    char appName[32], windowNames[WINDOWS + 5][32];
+    int i, count = windowCount(generation);
+
+    snprintf(appName, sizeof(appName), "Generation %u", generation);
+    for(i = 0; i < count; i++) {
+        snprintf(windowNames[i], 32, "%u.%d", generation, i);
+        windows[i].id = generation * 1000 + i;
+        windows[i].pid = (pid_t)generation;
+        windows[i].layer = 0;
+        windows[i].bounds = CGRectMake(i, generation, 800, 600);
+        windows[i].appName = appName;
+        windows[i].windowName = windowNames[i];
+        windows[i].title = NULL;
+    }
+
+    return WindowSnapshotCreateFromWindows(windows, count);
+}
+
+/* Return generation of snapshot, or exit if any window is not from it */
+static unsigned int checkSnapshot(WindowSnapshot *snapshot) {
+    const WindowInfo *info;
+    unsigned int generation;
+    char title[64];
+    int i, count;
+
+    count = WindowSnapshotGetCount(snapshot);
+    info = WindowSnapshotGetWindow(snapshot, 0);
+    generation = info ? (unsigned int)info->pid : 0;
+    if(count != windowCount(generation)) {
+        fprintf(stderr, ME ": generation %u has %d windows\n",
+                generation, count);
+        exit(1);
+    }
+    for(i = 0; i < count; i++) {
+        info = WindowSnapshotGetWindow(snapshot, i);
+        snprintf(title, sizeof(title), "Generation %u - %u.%d",
+                 generation, generation, i);
+        if((unsigned int)info->pid != generation ||
+           info->id != generation * 1000 + i ||
+           info->bounds.origin.y != generation ||
+           strcmp(info->title, title) != 0 ||
+           WindowSnapshotFindWindow(snapshot, info->id) != info)
+        {
+            fprintf(stderr, ME ": window %d of generation %u is \"%s\"\n",
+                    i, generation, info->title);
+            exit(1);
+        }
+    }
+
+    return generation;
+}
+
+/* Reader thread checks every snapshot is whole and no older than the last
+ * publish to have returned, and that it never goes back in time
+ */
+void *ReadSnapshots(void *readsPtr) {
+    long *reads = (long *)readsPtr;
+    WindowSnapshot *snapshot;
+    unsigned int oldest, newest, generation, last = 0;
+
+    while(!atomic_load(&done)) {
+        oldest = atomic_load(&completed);
+        snapshot = WindowSnapshotSlotAcquire(&slot);
+        newest = atomic_load(&announced);
+        generation = checkSnapshot(snapshot);
+        WindowSnapshotRelease(snapshot);
+
+        if(generation < oldest) {
+            fprintf(stderr, ME ": read stale generation %u after %u\n",
+                    generation, oldest);
+            exit(1);
+        } else if(generation > newest) {
+            fprintf(stderr, ME ": read generation %u before it was published\n",
+                    generation);
+            exit(1);
+        } else if(generation < last) {
+            fprintf(stderr, ME ": read generation %u after %u\n",
+                    generation, last);
+            exit(1);
+        }
+        last = generation;
+        (*reads)++;
+    }
+
+    return NULL;
+}
+
+/* Publisher thread publishes each generation in turn */
+void *PublishSnapshots(void *unused) {
+    unsigned int generation;
+
+    for(generation = 1; generation <= PUBLISHES; generation++) {
+        atomic_store(&announced, generation);
+        WindowSnapshotSlotPublish(&slot, createGeneration(generation));
+        atomic_store(&completed, generation);
+        if(generation % 64 == 0) sched_yield();
+    }
+    atomic_store(&done, 1);
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    pthread_t readers[READERS], publisher;
+    long reads[READERS], total;
+    int i;
+
+    WindowSnapshotSlotInit(&slot);
+    atomic_init(&announced, 0);
+    atomic_init(&completed, 0);
+    atomic_init(&done, 0);
+    WindowSnapshotSlotPublish(&slot, createGeneration(0));
+
+    pthread_create(&publisher, NULL, PublishSnapshots, NULL);
+    for(i = 0; i < READERS; i++) {
+        reads[i] = 0;
+        pthread_create(&readers[i], NULL, ReadSnapshots, (void *)&reads[i]);
+    }
+
+    total = 0;
+    pthread_join(publisher, NULL);
+    for(i = 0; i < READERS; i++) {
+        pthread_join(readers[i], NULL);
+        total += reads[i];
+    }
+    WindowSnapshotSlotDestroy(&slot);
+
+    printf("%d publishes, %d readers, %ld snapshots checked\n",
+           PUBLISHES, READERS, total);
+
+    return 0;
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,151 @@
+/* ========================================================================
+ * startbench.c - time programs from exec to exit
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Built in examples/mock, this runs the mock lswin and movewin, whose
+ * window server and permission probe are the mock's: set
+ * MOCKCARBON_PROBE_USEC to give the probe a realistic latency, and
+ * TMPDIR to somewhere the authorization cache can be written
+ */
+#define ME "startbench"
+#define USAGE "usage: " ME " [-h] [-n runs] command [args...]\n"
+#define FULL_USAGE USAGE \
+    "    -h       display this help text and exit\n" \
+    "    -n runs  times to run command (default 200)\n" \
+    "    command  program to run, with its output discarded\n"
+
+/* Return monotonic time in seconds, finer grained than gettimeofday() */
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Sort times in ascending order */
+static int compareTimes(const void *a, const void *b) {
+    double timeA = *(const double *)a, timeB = *(const double *)b;
+    return (timeA > timeB) - (timeA < timeB);
+}
+
+/* Run argv once with output discarded, return its wait status */
+static int runOnce(char **argv) {
+    pid_t pid;
+    int status, fd;
+
+    pid = fork();
+    if(pid == -1) return -1;
+    if(pid == 0) {
+        fd = open("/dev/null", O_WRONLY);
+        if(fd != -1) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    if(waitpid(pid, &status, 0) == -1) return -1;
+    return status;
+}
+
+int main(int argc, char **argv) {
+    double *times, start;
+    int ch, i, status, n = 200, failed = 0;
+
+#define DIE(msg) { fprintf(stderr, ME ": " msg "\n"); exit(1); }
+#define DIE_OPT(msg) \
+    { fprintf(stderr, ME ": " msg " -- %c\n" USAGE, optopt); return 1; }
+
+    while((ch = getopt(argc, argv, "+:hn:")) != -1) {
+        switch(ch) {
+            case 'h':
+                printf(FULL_USAGE);
+                return 0;
+            case 'n':
+                n = atoi(optarg);
+                if(n <= 0) DIE("runs must be positive integer");
+                break;
+            case ':':
+                DIE_OPT("option requires an argument");
+            default:
+                DIE_OPT("illegal option");
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    if(argc < 1) {
+        fprintf(stderr, USAGE);
+        return 1;
+    }
+
+    /* Run once untimed, so page cache and any authorization cache are
+     * warm, as they are for a script that runs the command in a loop
+     */
+    runOnce(argv);
+
+    times = (double *)malloc(n * sizeof(double));
+    if(!times) DIE("out of memory");
+    for(i = 0; i < n; i++) {
+        start = now();
+        status = runOnce(argv);
+        times[i] = now() - start;
+        if(status == -1) DIE("unable to run command");
+        if(!WIFEXITED(status) || WEXITSTATUS(status) == 127) failed++;
+    }
+    if(failed) fprintf(stderr, ME ": %d runs did not exit normally\n", failed);
+
+    qsort(times, n, sizeof(double), compareTimes);
+    printf(
+        "p50 %8.3f ms  p99 %8.3f ms ",
+        times[n / 2] * 1e3, times[n * 99 / 100] * 1e3
+    );
+    for(i = 0; i < argc; i++) printf(" %s", argv[i]);
+    printf("\n");
+    free(times);
+
+    return failed ? 1 : 0;
+
+#undef DIE_OPT
+#undef DIE
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,220 @@
+/* ========================================================================
+ * streamrss.c - stream every window and report peak memory use
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "winstream.h"
+#ifdef MOCK_CARBON
+#include "mockcarbon.h"
+#endif
+
+/* Streams windows and prints peak RSS. Against the mock, -w streams
+ * each count of synthetic windows in a process of its own, and fails if
+ * peak RSS grows by more than MAX_BYTES_PER_WINDOW for each window
+ * beyond the first count: the window IDs are listed up front, but their
+ * descriptions, names, and titles must only ever be held a chunk at a
+ * time, and any of those alone costs more per window than that.
+ */
+#define ME "streamrss"
+#ifdef MOCK_CARBON
+#define OPTIONS ":hr:w:"
+#define USAGE "usage: " ME " [-h] [-r rounds] [-w windows[,windows...]]\n"
+#define FULL_USAGE USAGE \
+    "    -h          display this help text and exit\n" \
+    "    -r rounds   times to stream every window (default 1)\n" \
+    "    -w windows  stream this many windows in a process of its own,\n" \
+    "                once per count, and check peak RSS stays flat\n"
+#else
+#define OPTIONS ":hr:"
+#define USAGE "usage: " ME " [-h] [-r rounds]\n"
+#define FULL_USAGE USAGE \
+    "    -h          display this help text and exit\n" \
+    "    -r rounds   times to stream every window (default 1)\n"
+#endif
+#define MAX_COUNTS 16
+#define MAX_BYTES_PER_WINDOW 64
+#define APPS 8
+
+/* Count windows and title bytes, so every chunk is actually touched */
+static int countWindows(const WindowInfo *windows, int count, void *data) {
+    long *totals = (long *)data;
+    int i;
+
+    totals[0] += count;
+    for(i = 0; i < count; i++) totals[1] += strlen(windows[i].title);
+    return 0;
+}
+
+/* Stream every window rounds times, printing totals; return 0, or -1 if
+ * unable to list windows
+ */
+static int streamRounds(int rounds) {
+    WinStreamFilter filter;
+    long totals[2] = { 0, 0 };
+
+    WinStreamFilterInit(&filter);
+    for(; rounds > 0; rounds--) {
+        if(WinStreamWindows(&filter, countWindows, (void *)totals) == -1) {
+            fprintf(stderr, ME ": unable to list windows\n");
+            return -1;
+        }
+    }
+    printf("%ld windows, %ld title bytes", totals[0], totals[1]);
+    return 0;
+}
+
+/* Peak RSS in KB; ru_maxrss is in bytes on macOS, in KB on Linux */
+static long peakKB(const struct rusage *usage) {
+#ifdef __APPLE__
+    return (long)usage->ru_maxrss / 1024;
+#else
+    return (long)usage->ru_maxrss;
+#endif
+}
+
+#ifdef MOCK_CARBON
+/* Stream count synthetic windows in a child process, and return its
+ * peak RSS in KB, or -1 if it failed
+ */
+static long streamInChild(int count, int rounds) {
+    struct rusage usage;
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid == -1) return -1;
+    if(pid == 0) {
+        MockCarbonMakeSyntheticWindows(count, APPS);
+        exit(streamRounds(rounds) ? 1 : 0);
+    }
+    if(wait4(pid, &status, 0, &usage) != pid ||
+       !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return -1;
+    }
+    return peakKB(&usage);
+}
+#endif
+
+int main(int argc, char **argv) {
+    struct rusage usage;
+    int ch, rounds = 1;
+#ifdef MOCK_CARBON
+    int counts[MAX_COUNTS], numCounts = 0, i, failed = 0;
+    long kb, baseKB = 0;
+    double perWindow;
+    char *p, *end;
+#endif
+
+#define DIE(msg) { fprintf(stderr, ME ": " msg "\n"); exit(1); }
+#define DIE_OPT(msg) \
+    { fprintf(stderr, ME ": " msg " -- %c\n" USAGE, optopt); return 1; }
+
+    while((ch = getopt(argc, argv, OPTIONS)) != -1) {
+        switch(ch) {
+            case 'h':
+                printf(FULL_USAGE);
+                return 0;
+            case 'r':
+                rounds = atoi(optarg);
+                if(rounds <= 0) DIE("rounds must be positive");
+                break;
+#ifdef MOCK_CARBON
+            case 'w':
+                for(p = optarg; *p; p = *end ? end + 1 : end) {
+                    if(numCounts == MAX_COUNTS) DIE("too many window counts");
+                    counts[numCounts] = strtol(p, &end, 10);
+                    if(end == p || counts[numCounts] <= 0 ||
+                       (*end && *end != ','))
+                    {
+                        DIE("windows must be positive integers");
+                    }
+                    if(numCounts > 0 &&
+                       counts[numCounts] <= counts[numCounts - 1])
+                    {
+                        DIE("window counts must increase");
+                    }
+                    numCounts++;
+                }
+                break;
+#endif
+            case ':':
+                DIE_OPT("option requires an argument");
+            default:
+                DIE_OPT("illegal option");
+        }
+    }
+
+#ifdef MOCK_CARBON
+    /* Peak RSS is a high water mark, so each count needs a fresh process */
+    for(i = 0; i < numCounts; i++) {
+        kb = streamInChild(counts[i], rounds);
+        if(kb == -1) DIE("unable to stream windows");
+        if(i == 0) {
+            baseKB = kb;
+            printf(", peak RSS %ld KB\n", kb);
+            continue;
+        }
+        perWindow = (kb - baseKB) * 1024.0 / (counts[i] - counts[0]);
+        printf(
+            ", peak RSS %ld KB, %.1f bytes/window more than %d windows\n",
+            kb, perWindow, counts[0]
+        );
+        if(perWindow > MAX_BYTES_PER_WINDOW) {
+            fflush(stdout);
+            fprintf(
+                stderr, ME ": peak RSS grew by %.1f bytes/window, "
+                "at most %d expected\n", perWindow, MAX_BYTES_PER_WINDOW
+            );
+            failed = 1;
+        }
+    }
+    if(numCounts > 0) return failed;
+#endif
+
+    /* Stream every window, as many times as asked, to show RSS is flat */
+    if(streamRounds(rounds)) return 1;
+    getrusage(RUSAGE_SELF, &usage);
+    printf(", peak RSS %ld KB\n", peakKB(&usage));
+    return 0;
+
+#undef DIE_OPT
+#undef DIE
+}
+
+
+/* ======================================================================== */
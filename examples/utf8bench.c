@@ -0,0 +1,236 @@
+/* ========================================================================
+ * utf8bench.c - time bulk UTF-8 conversion of mixed-script titles
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sys/time.h>
+#include <unistd.h>
+#include "winutf8.h"
+
+/* Built twice by both examples/Makefile and examples/mock/Makefile:
+ * utf8bench uses the vector ASCII paths in winutf8.c, utf8bench-scalar is
+ * compiled with -DWINUTF8_SCALAR. Either way, converting the batch must
+ * not be slower than converting one title at a time; each is timed by its
+ * fastest round, so that one noisy round does not decide it. Batches of
+ * window list size stay in cache, where the batch is ahead by its cheaper
+ * conversion; far larger ones come down to memory, which it gets through
+ * faster only once split over several CPUs.
+ */
+#define ME "utf8bench"
+#define USAGE "usage: " ME " [-h] [-n titles]\n"
+#define FULL_USAGE USAGE \
+    "    -h          display this help text and exit\n" \
+    "    -n titles   titles to convert (default 100000)\n"
+#define TITLES_PER_METHOD 1000000   /* over all rounds, at least 10 */
+#define MIN_ROUNDS 10
+
+/* Title fragments in several scripts, mostly ASCII like real titles */
+static const char *fragments[] = {
+    "iTerm2 - Default", "Firefox - Inbox", "README.md", "build log",
+    "Caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9\x65", "M\xc3\xbcnchen",
+    "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82",
+    "\xe4\xb8\xad\xe6\x96\x87\xe6\xa0\x87\xe9\xa2\x98",
+    "\xe3\x81\x82\xe3\x82\x8a\xe3\x81\x8c\xe3\x81\xa8\xe3\x81\x86",
+    "\xf0\x9f\x98\x80 party", "\xce\x95\xce\xbb\xce\xbb\xce\xac\xce\xb4\xce\xb1"
+};
+
+/* Return current time in seconds */
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Convert every title one at a time, the way CFDictionaryCopyCString()
+ * works, return total bytes
+ */
+static long convertEach(CFStringRef *strings, int count) {
+    CFIndex maxSize;
+    char *value;
+    long bytes = 0;
+    int i;
+
+    for(i = 0; i < count; i++) {
+        maxSize = CFStringGetMaximumSizeForEncoding(
+            CFStringGetLength(strings[i]), kCFStringEncodingUTF8
+        ) + 1;
+        value = (char *)malloc(maxSize);
+        CFStringGetCString(strings[i], value, maxSize, kCFStringEncodingUTF8);
+        bytes += strlen(value);
+        free(value);
+    }
+
+    return bytes;
+}
+
+/* Convert the whole batch at once into one new buffer */
+static long convertBatch(CFStringRef *strings, char **cstrings, int count) {
+    char *buffer;
+    long bytes = 0;
+    int i;
+
+    buffer = CFStringsCopyUTF8(strings, count, cstrings);
+    for(i = 0; buffer && i < count; i++) bytes += strlen(cstrings[i]);
+    free(buffer);
+
+    return bytes;
+}
+
+/* Convert the whole batch into the same buffers as the last batch */
+static long convertReused(
+    CFStringRef *strings,
+    char **cstrings,
+    int count,
+    UTF8Buffers *buffers
+) {
+    long bytes = 0;
+    int i;
+
+    if(CFStringsConvertUTF8(strings, count, cstrings, buffers)) return 0;
+    for(i = 0; i < count; i++) bytes += strlen(cstrings[i]);
+
+    return bytes;
+}
+
+/* Print fastest of rounds per title, which is returned, and bytes */
+static double report(
+    const char *label,
+    const double *times,
+    int rounds,
+    int count,
+    long bytes
+) {
+    double best = times[0];
+    int j;
+
+    for(j = 1; j < rounds; j++) if(times[j] < best) best = times[j];
+    best = best * 1e9 / count;
+    printf(
+        "%-11s %d titles x %d: %.1f ns/title, %ld bytes\n",
+        label, count, rounds, best, bytes
+    );
+
+    return best;
+}
+
+int main(int argc, char **argv) {
+    CFStringRef *strings;
+    UTF8Buffers buffers;
+    char **cstrings, buf[256];
+    double *eachTimes, *batchTimes, *reusedTimes;
+    double start, each, batch, reused;
+    long eachBytes = 0, batchBytes = 0, reusedBytes = 0;
+    int ch, i, j, nFragments, count = 100000, rounds, failed = 0;
+
+#define DIE(msg) { fprintf(stderr, ME ": " msg "\n"); exit(1); }
+#define DIE_OPT(msg) \
+    { fprintf(stderr, ME ": " msg " -- %c\n" USAGE, optopt); return 1; }
+
+    while((ch = getopt(argc, argv, ":hn:")) != -1) {
+        switch(ch) {
+            case 'h':
+                printf(FULL_USAGE);
+                return 0;
+            case 'n':
+                count = atoi(optarg);
+                if(count <= 0) DIE("titles must be positive");
+                break;
+            case ':':
+                DIE_OPT("option requires an argument");
+            default:
+                DIE_OPT("illegal option");
+        }
+    }
+    rounds = TITLES_PER_METHOD / count;
+    if(rounds < MIN_ROUNDS) rounds = MIN_ROUNDS;
+
+    /* Build repeatable titles from three fragments each */
+    nFragments = sizeof(fragments) / sizeof(fragments[0]);
+    srandom(1);
+    strings = (CFStringRef *)malloc(count * sizeof(CFStringRef));
+    cstrings = (char **)malloc(count * sizeof(char *));
+    eachTimes = (double *)malloc(rounds * sizeof(double));
+    batchTimes = (double *)malloc(rounds * sizeof(double));
+    reusedTimes = (double *)malloc(rounds * sizeof(double));
+    for(i = 0; i < count; i++) {
+        snprintf(
+            buf, sizeof(buf), "%s - %s %s", fragments[random() % nFragments],
+            fragments[random() % nFragments], fragments[random() % nFragments]
+        );
+        strings[i] =
+            CFStringCreateWithCString(NULL, buf, kCFStringEncodingUTF8);
+    }
+
+    /* Interleave rounds, so that all three see the same machine */
+    memset(&buffers, 0, sizeof(buffers));
+    for(j = 0; j < rounds; j++) {
+        start = now();
+        eachBytes = convertEach(strings, count);
+        eachTimes[j] = now() - start;
+        start = now();
+        batchBytes = convertBatch(strings, cstrings, count);
+        batchTimes[j] = now() - start;
+        start = now();
+        reusedBytes = convertReused(strings, cstrings, count, &buffers);
+        reusedTimes[j] = now() - start;
+    }
+    UTF8BuffersFree(&buffers);
+    each = report("one by one", eachTimes, rounds, count, eachBytes);
+    batch = report("batch", batchTimes, rounds, count, batchBytes);
+    reused = report("reused", reusedTimes, rounds, count, reusedBytes);
+
+    if(batchBytes != eachBytes || reusedBytes != eachBytes) {
+        fprintf(stderr, ME ": batch conversion lost bytes\n");
+        failed = 1;
+    }
+    if(batch > each || reused > each) {
+        fprintf(stderr, ME ": batch conversion slower than one by one\n");
+        failed = 1;
+    }
+
+    for(i = 0; i < count; i++) CFRelease(strings[i]);
+    free(strings);
+    free(cstrings);
+    free(eachTimes);
+    free(batchTimes);
+    free(reusedTimes);
+
+    return failed;
+
+#undef DIE_OPT
+#undef DIE
+}
+
+
+/* ======================================================================== */
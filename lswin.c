@@ -34,28 +34,60 @@
  * ========================================================================
  */
 
+#include <fnmatch.h>
+#include <sys/time.h>
 #include "winutils.h"
+#include "winshm.h"
+#include "winfuzzy.h"
+#include "winhistory.h"
+#include "winstream.h"
+#include "winutf8.h"
 
 #define ME "lswin"
-#define USAGE "usage: " ME " [-h] [-l] [-i id] [title]\n"
+#define USAGE \
+    "usage: " ME " [-h] [-l] [-i id] [-A | -O opts] [-L layers]\n" \
+    "             [-p name [-t secs]] [-r log [-t secs | -s time]]\n" \
+    "             [-z query | title]\n"
 #define FULL_USAGE USAGE \
     "    -h       display this help text and exit\n" \
     "    -l       long display, include window ID column in output\n" \
     "    -i id    show only windows with this window ID (-1 for all)\n" \
+    "    -A       list every window on every space, including off screen\n" \
+    "             (the same as -O all)\n" \
+    "    -O opts  list the windows these comma separated options select:\n" \
+    "             all, onscreen, nodesktop, above=id, below=id,\n" \
+    "             including=id\n" \
+    "    -L min[:max]  list only windows in this layer range (default 0,\n" \
+    "             or every layer with -A or -O)\n" \
+    "    -p name  publish windows to shared memory instead of printing\n" \
+    "             (e.g. " WINSHM_DEFAULT_NAME ")\n" \
+    "    -t secs  with -p or -r, repeat every secs seconds until killed\n" \
+    "    -r log   record windows to history log instead of printing\n" \
+    "    -s time  with -r, instead print windows as of time from the log\n" \
+    "             (seconds since the epoch, or negative for seconds ago)\n" \
+    "    -z query fuzzy match query, list best matching windows first\n" \
     "    title    pattern to match \"Application - Title\" against\n"
 
 typedef struct {
     int longDisplay;   /* include window ID column in output */
     int id;            /* show only windows with this window ID (-1 for all) */
     int numFound;      /* out parameter, number of windows found */
+    char *subPattern;  /* "*title*" to match, where EnumerateWindows() is
+                          not doing the matching (NULL for all windows) */
 } LsWinCtx;
 
-/* Callback for EnumerateWindows() prints title of each window it encounters */
-void PrintWindow(CFDictionaryRef window, void *ctxPtr) {
+/* Callback for EnumerateWindowListUTF8() and
+ * EnumerateWindowListFuzzyNames() prints title of each window it
+ * encounters, from the names they already converted
+ */
+void PrintNamedWindow(
+    CFDictionaryRef window,
+    char *appName,
+    char *windowName,
+    void *ctxPtr
+) {
     LsWinCtx *ctx = (LsWinCtx *)ctxPtr;
     int windowId = CFDictionaryGetInt(window, kCGWindowNumber);
-    char *appName = CFDictionaryCopyCString(window, kCGWindowOwnerName);
-    char *windowName = CFDictionaryCopyCString(window, kCGWindowName);
     char *title = windowTitle(appName, windowName);
     CGPoint position = CGWindowGetPosition(window);
     CGSize size = CGWindowGetSize(window);
@@ -70,14 +102,85 @@ void PrintWindow(CFDictionaryRef window, void *ctxPtr) {
         ctx->numFound++;
     }
     free(title);
-    free(windowName);
-    free(appName);
+}
+
+/* Print window from a history log or stream, the same way as
+ * PrintNamedWindow()
+ */
+void PrintWindowInfo(const WindowInfo *window, LsWinCtx *ctx) {
+    if((ctx->id == -1 || ctx->id == (int)window->id) &&
+       (!ctx->subPattern || fnmatch(ctx->subPattern, window->title, 0) == 0))
+    {
+        if(ctx->longDisplay) printf("%d - ", (int)window->id);
+        printf(
+            "%s - %d %d %d %d\n", window->title,
+            (int)window->bounds.origin.x, (int)window->bounds.origin.y,
+            (int)window->bounds.size.width, (int)window->bounds.size.height
+        );
+        ctx->numFound++;
+    }
+}
+
+/* Return current time in milliseconds since the epoch */
+static int64_t nowMillis() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* Append one sample of windows matching pattern to history log */
+static int RecordWindows(WinHistory *history, char *pattern) {
+    WindowSnapshot *snapshot = WindowSnapshotCreate(pattern);
+    int count = WindowSnapshotGetCount(snapshot), i, status;
+    WindowInfo *windows =
+        (WindowInfo *)malloc((count + 1) * sizeof(WindowInfo));
+
+    for(i = 0; i < count; i++) {
+        windows[i] = *WindowSnapshotGetWindow(snapshot, i);
+    }
+    status = WinHistoryAppend(history, nowMillis(), windows, count);
+    free(windows);
+    WindowSnapshotRelease(snapshot);
+
+    return status;
+}
+
+/* Print windows as of when (see -s) from history log */
+static void PrintHistory(WinHistory *history, double when, LsWinCtx *ctx) {
+    WindowInfo *windows;
+    int64_t time, sampleTime;
+    int count, i;
+
+    time = when < 0 ? nowMillis() + (int64_t)(when * 1000) :
+        (int64_t)(when * 1000);
+    count = WinHistoryQuery(history, time, &windows, &sampleTime);
+    for(i = 0; i < count; i++) PrintWindowInfo(&windows[i], ctx);
+    free(windows);
+}
+
+/* Callback for WinStreamWindows() prints each window of a chunk */
+static int PrintWindowChunk(
+    const WindowInfo *windows,
+    int count,
+    void *ctxPtr
+) {
+    int i;
+
+    for(i = 0; i < count; i++) PrintWindowInfo(&windows[i], (LsWinCtx *)ctxPtr);
+    return 0;
 }
 
 int main(int argc, char **argv) {
     LsWinCtx ctx;
     int ch;
-    char *pattern = NULL;
+    char *pattern = NULL, *publishName = NULL, *fuzzyQuery = NULL;
+    char *historyPath = NULL, *showTime = NULL;
+    double publishInterval = 0;
+    int streaming = 0;
+    WinStreamFilter filter;
+    WinShmPublisher *publisher;
+    WinHistory *history;
+    CF_SCOPED CFArrayRef windowList = NULL;
 
 #define DIE(msg) { fprintf(stderr, ME ": " msg "\n"); exit(1); }
 #define DIE_OPT(msg) \
@@ -87,7 +190,12 @@ int main(int argc, char **argv) {
     ctx.longDisplay = 0;
     ctx.id = -1;
     ctx.numFound = 0;
-    while((ch = getopt(argc, argv, ":hli:")) != -1) {
+    ctx.subPattern = NULL;
+    WinStreamFilterInit(&filter);
+    filter.options =
+        kCGWindowListOptionOnScreenOnly|kCGWindowListExcludeDesktopElements;
+    filter.maxLayer = 0;
+    while((ch = getopt(argc, argv, ":hli:AL:O:p:t:r:s:z:")) != -1) {
         switch(ch) {
             case 'h':
                  printf(FULL_USAGE);
@@ -98,6 +206,50 @@ int main(int argc, char **argv) {
             case 'i':
                 ctx.id = atoi(optarg);
                 break;
+            case 'A':
+                /* Every window, and every layer unless -L narrows it */
+                if(!streaming) filter.maxLayer = INT_MAX;
+                filter.options = kCGWindowListOptionAll;
+                streaming = 1;
+                break;
+            case 'O':
+                if(WinStreamFilterParseOptions(&filter, optarg) == -1) {
+                    DIE("options must be a comma separated list of all, "
+                        "onscreen, above=id, below=id, including=id, "
+                        "and nodesktop");
+                }
+                if(!streaming) filter.maxLayer = INT_MAX;
+                streaming = 1;
+                break;
+            case 'L':
+                switch(sscanf(
+                    optarg, "%d:%d", &filter.minLayer, &filter.maxLayer
+                )) {
+                    case 1:
+                        filter.maxLayer = filter.minLayer;
+                        break;
+                    case 2:
+                        break;
+                    default:
+                        DIE("layers must be min or min:max");
+                }
+                streaming = 1;
+                break;
+            case 'p':
+                publishName = optarg;
+                break;
+            case 't':
+                publishInterval = atof(optarg);
+                break;
+            case 'r':
+                historyPath = optarg;
+                break;
+            case 's':
+                showTime = optarg;
+                break;
+            case 'z':
+                fuzzyQuery = optarg;
+                break;
             case ':':
                 DIE_OPT("option requires an argument");
             default:
@@ -106,16 +258,103 @@ int main(int argc, char **argv) {
     }
     argc -= optind;
     argv += optind;
-    if(argc > 0) pattern = argv[0];
+    if(argc > 0) {
+        if(fuzzyQuery) DIE("title pattern cannot be combined with -z");
+        pattern = argv[0];
+        ctx.subPattern = (char *)malloc(strlen(pattern) + 3);
+        sprintf(ctx.subPattern, "*%s*", pattern);
+    }
+    if(showTime && !historyPath) DIE("-s requires a history log given by -r");
+    if(ctx.id != -1 && (publishName || (historyPath && !showTime))) {
+        DIE("-i cannot be combined with -p, or with -r except with -s");
+    }
+    if(streaming && (publishName || historyPath)) {
+        DIE("-A, -O and -L cannot be combined with -p or -r");
+    }
+    if(fuzzyQuery && (publishName || historyPath)) {
+        DIE("-z cannot be combined with -p or -r");
+    }
+    if(fuzzyQuery && streaming) DIE("-z cannot be combined with -A, -O or -L");
 
-    /* Die if we are not authorized to do screen recording */
-    if(!isAuthorizedForScreenRecording()) DIE("not authorized to do screen recording");
+    /* Print windows from the history log, which needs no permissions */
+    if(showTime) {
+        history = WinHistoryOpen(historyPath, 0);
+        if(!history) DIE("unable to read history log");
+        PrintHistory(history, atof(showTime), &ctx);
+        WinHistoryClose(history);
+        return ctx.numFound > 0 ? 0 : 1;
+    }
+
+    /* Die if we are not authorized to do screen recording; a recent positive
+     * answer is trusted without probing, and rechecked if nothing is found
+     * and the window list looks like permission was revoked
+     */
+    if(!isAuthorizedForScreenRecordingCached(AUTH_CACHE_TTL)) {
+        DIE("not authorized to do screen recording");
+    }
+
+    /* Publish matching windows to shared memory, repeatedly if requested */
+    if(publishName) {
+        publisher = WinShmPublisherOpen(publishName);
+        if(!publisher) {
+            DIE("unable to open shared memory region, or already publishing");
+        }
+        do {
+            if(WinShmPublish(publisher, pattern) == 0 &&
+               !recheckAuthorizedForScreenRecording(NULL))
+            {
+                DIE("not authorized to do screen recording");
+            }
+            if(publishInterval > 0) usleep(publishInterval * 1000000);
+        } while(publishInterval > 0);
+        WinShmPublisherClose(publisher);
+        return 0;
+    }
 
-    /* Print matching windows */
-    EnumerateWindows(pattern, PrintWindow, (void *)&ctx);
+    /* Record matching windows to history log, repeatedly if requested */
+    if(historyPath) {
+        history = WinHistoryOpen(historyPath, 1);
+        if(!history) DIE("unable to open history log");
+        do {
+            if(RecordWindows(history, pattern) == -1) {
+                DIE("unable to write history log");
+            }
+            if(publishInterval > 0) usleep(publishInterval * 1000000);
+        } while(publishInterval > 0);
+        WinHistoryClose(history);
+        return 0;
+    }
+
+    /* Print matching windows, best first if fuzzy matching, or a chunk at
+     * a time when there may be any number of them; if nothing is found,
+     * the window list shows whether permission was revoked
+     */
+    if(streaming) {
+        if(WinStreamWindows(&filter, PrintWindowChunk, (void *)&ctx) == -1) {
+            DIE("unable to list windows");
+        }
+    } else {
+        windowList = CopyWindowList();
+        if(fuzzyQuery) {
+            EnumerateWindowListFuzzyNames(
+                windowList, fuzzyQuery, 0, PrintNamedWindow, (void *)&ctx
+            );
+        } else {
+            EnumerateWindowListUTF8(
+                windowList, pattern, PrintNamedWindow, (void *)&ctx
+            );
+        }
+    }
+
+    if(ctx.numFound == 0 && !recheckAuthorizedForScreenRecording(windowList)) {
+        DIE("not authorized to do screen recording");
+    }
 
     /* Return success if found any windows, or no windows but also no query */
-    return (ctx.numFound > 0 || (pattern == NULL && ctx.id == -1)) ? 0 : 1;
+    return (
+        ctx.numFound > 0 ||
+        (pattern == NULL && fuzzyQuery == NULL && ctx.id == -1)
+    ) ? 0 : 1;
 
 #undef DIE_OPT
 }
@@ -34,30 +34,81 @@
  * ========================================================================
  */
 
+#include <getopt.h>
 #include "winutils.h"
+#include "winfuzzy.h"
+#include "winjournal.h"
+#include "winclaim.h"
+#include "winsnap.h"
 
 #define ME "movewin"
 #define USAGE \
-"usage: " ME " [-h] [-n] [-i id | title] x y [width height]\n"
+"usage: " ME " [-h] [-n] [-a [-o dx,dy]] [-i id | -z query | title]\n" \
+"               x y [width height]\n" \
+"       " ME " --snap[=px] | --snap-resize[=px] [-i id | -z query | title]\n" \
+"               [x y [width height]]\n" \
+"       " ME " --undo [n] | --redo [n]\n"
 #define FULL_USAGE USAGE \
 "    -h            display this help text and exit\n" \
 "    -n            negative x y is off screen (default from bottom right)\n" \
+"    -a            move all matching windows, not only the first\n" \
+"    -o dx,dy      with -a, offset each further window by dx,dy (cascade)\n" \
 "    -i id         window ID to move (one of title or ID is required)\n" \
+"    -z query      fuzzy match query, move best matching window\n" \
 "    title         pattern to match \"Application - Title\" against\n" \
-"    x y           required, position to move window to\n" \
-"    width height  optional, new size to resize window to\n"
+"    x y           position to move window to, required unless snapping\n" \
+"    width height  optional, new size to resize window to\n" \
+"    --snap[=px]   move window (from x y, if given) until its edges meet\n" \
+"                  edges of other windows or displays within px (16)\n" \
+"    --snap-resize[=px]  like --snap, but move each edge on its own\n" \
+"    --undo [n]    put back windows moved by the last n runs (default 1)\n" \
+"    --redo [n]    move windows again for the last n undone runs\n"
 
 /* Undocumented accessibility API to get window ID, see winutils.c */
 extern AXError _AXUIElementGetWindow(AXUIElementRef, CGWindowID *out);
 
-/* Hold target position, optional size, mutex so we only move first window */
+/* Ways to snap to nearby edges, see winsnap.h */
+#define SNAP_MOVE 1
+#define SNAP_RESIZE 2
+
+/* One matched window, with where it should end up */
+typedef struct {
+    CFDictionaryRef window;  /* borrowed from the window list being searched */
+    pid_t pid;               /* owning application, moves are grouped by it */
+    int order;               /* match order, kept within each group */
+    CGPoint position;        /* move window to this position */
+    CGSize size;             /* resize window to this size */
+    CGPoint oldPosition;     /* position before moving, for the journal */
+    CGSize oldSize;          /* size before resizing, for the journal */
+    int needsMove;           /* position differs from current position */
+    int needsResize;         /* size was specified and differs */
+    uint32_t ticket;         /* claim on the window, see winclaim.h */
+} PendingMove;
+
+/* Hold target position, optional size, and windows matched so far */
 typedef struct {
     int id;              /* window ID to search for */
     int fromRight;       /* x coordinate is offset from right, not left */
     int fromBottom;      /* y coordinate is offset from bottom, not top */
+    int hasPosition;     /* otherwise start from where window is now */
     CGPoint position;    /* move window to this position */
     CGSize size;         /* resize window to this size */
     int hasSize;         /* only resize if this is true */
+    int allWindows;      /* move every match, not only the first */
+    CGPoint offset;      /* with allWindows, shift each further match */
+    int snap;            /* SNAP_MOVE or SNAP_RESIZE to snap, else 0 */
+    CGFloat snapTolerance;       /* how near edges must be to snap */
+    WinSnapIndex *snapIndex;     /* edges of every window and display */
+    PendingMove *moves;  /* matched windows, in match order */
+    int numMoves;
+    int maxMoves;
+    int journaling;              /* record moves in the journal */
+    WinJournal *journal;         /* opened on first move, if journaling */
+    uint32_t batch;              /* journal batch of this run's moves */
+    int claiming;                /* coordinate through the claim table */
+    WinClaimTable *claims;       /* opened on first match, if claiming */
+    WinJournalTarget *targets;   /* when replaying, frames to restore */
+    int numTargets;
     int movedWindow;     /* set to true if we have moved any window */
 } MoveWinCtx;
 
@@ -68,23 +119,65 @@ static bool startsWithMinus(char *s) {
     return *p == '-';
 }
 
-/* Callback for EnumerateWindows() moves the first window it encounters */
+/* Record that window should get new position, and new size if hasSize */
+static void AddPendingMove(
+    MoveWinCtx *ctx,
+    CFDictionaryRef window,
+    CGPoint newPosition,
+    CGSize newSize,
+    int hasSize
+) {
+    PendingMove *move;
+
+    if(ctx->numMoves == ctx->maxMoves) {
+        ctx->maxMoves = ctx->maxMoves ? ctx->maxMoves * 2 : 8;
+        ctx->moves = (PendingMove *)realloc(
+            ctx->moves, ctx->maxMoves * sizeof(PendingMove)
+        );
+    }
+    move = &ctx->moves[ctx->numMoves];
+    move->window = window;
+    move->pid = CFDictionaryGetInt(window, kCGWindowOwnerPID);
+    move->order = ctx->numMoves;
+    move->oldPosition = CGWindowGetPosition(window);
+    move->oldSize = CGWindowGetSize(window);
+    move->position = newPosition;
+    move->size = hasSize ? newSize : move->oldSize;
+    move->needsMove = !CGPointEqualToPoint(newPosition, move->oldPosition);
+    move->needsResize = hasSize && !CGSizeEqualToSize(newSize, move->oldSize);
+    if(ctx->claiming && !ctx->claims) {
+        ctx->claims = WinClaimOpen(NULL);
+        ctx->claiming = ctx->claims != NULL;
+        if(!ctx->claiming) {
+            fprintf(stderr, ME ": unable to open claim table, "
+                    "moving without it\n");
+        }
+    }
+    move->ticket = ctx->claims ? WinClaimTake(
+        ctx->claims, CFDictionaryGetInt(window, kCGWindowNumber)
+    ) : 0;
+    ctx->numMoves++;
+}
+
+/* Callback for EnumerateWindows() records where each matching window goes;
+ * only the first match is kept unless all windows were requested
+ */
 void MoveWindow(CFDictionaryRef window, void *ctxPtr) {
     MoveWinCtx *ctx = (MoveWinCtx *)ctxPtr;
     int windowId = CFDictionaryGetInt(window, kCGWindowNumber);
-    CGPoint newPosition, actualPosition;
+    CGPoint newPosition;
     CGSize newSize, actualSize;
-    CGRect displayBounds;
-    AXUIElementRef appWindow = NULL;
+    CGRect displayBounds, frame;
 
-    /* If we already moved a window, skip all subsequent ones */
-    if(ctx->movedWindow) return;
+    /* If we already have a window, skip all subsequent ones */
+    if(ctx->numMoves > 0 && !ctx->allWindows) return;
 
     /* If a windowId was specified, and this isn't that window, skip it */
     if(ctx->id != -1 && ctx->id != windowId) return;
 
     /* Recalculate target window position if we got negative values */
-    newPosition = ctx->position;
+    newPosition = ctx->hasPosition ?
+        ctx->position : CGWindowGetPosition(window);
     actualSize = CGWindowGetSize(window);
     newSize = ctx->hasSize ? ctx->size : actualSize;
     if(ctx->fromRight || ctx->fromBottom) {
@@ -99,23 +192,153 @@ void MoveWindow(CFDictionaryRef window, void *ctxPtr) {
         }
     }
 
-    /* Move window, unless positions already match */
-    actualPosition = CGWindowGetPosition(window);
-    if(!CGPointEqualToPoint(newPosition, actualPosition)) {
-        if(!appWindow) appWindow = AXWindowFromCGWindow(window);
-        AXWindowSetPosition(appWindow, newPosition);
+    /* Cascade (or stack, with zero offset) further matches */
+    if(ctx->hasPosition) {
+        newPosition.x += ctx->numMoves * ctx->offset.x;
+        newPosition.y += ctx->numMoves * ctx->offset.y;
+    }
+
+    /* Snap to the nearest edges of other windows and of displays */
+    if(ctx->snap) {
+        frame = WinSnapFrame(
+            ctx->snapIndex, windowId,
+            CGRectMake(
+                newPosition.x, newPosition.y, newSize.width, newSize.height
+            ),
+            ctx->snapTolerance, ctx->snap == SNAP_RESIZE
+        );
+        newPosition = frame.origin;
+        newSize = frame.size;
+
+        /* Later matches snap to where this window is going, not where
+         * it was when the index was built
+         */
+        WinSnapIndexUpdate(ctx->snapIndex, windowId, frame);
     }
 
-    /* If size was specified, resize window, unless sizes already match */
-    if(ctx->hasSize) {
-        if(!CGSizeEqualToSize(newSize, actualSize)) {
-            if(!appWindow) appWindow = AXWindowFromCGWindow(window);
-            AXWindowSetSize(appWindow, newSize);
+    AddPendingMove(
+        ctx, window, newPosition, newSize,
+        ctx->hasSize || ctx->snap == SNAP_RESIZE
+    );
+}
+
+/* Callback for EnumerateWindows() records where windows in the journal
+ * replay go back to
+ */
+void RestoreWindow(CFDictionaryRef window, void *ctxPtr) {
+    MoveWinCtx *ctx = (MoveWinCtx *)ctxPtr;
+    CGWindowID windowId = CFDictionaryGetInt(window, kCGWindowNumber);
+    int i;
+
+    for(i = 0; i < ctx->numTargets; i++) {
+        if(ctx->targets[i].windowId == windowId) {
+            AddPendingMove(
+                ctx, window, ctx->targets[i].position, ctx->targets[i].size, 1
+            );
+            return;
+        }
+    }
+}
+
+/* Order pending moves by application, then by match order */
+static int compareMoves(const void *a, const void *b) {
+    const PendingMove *moveA = (const PendingMove *)a;
+    const PendingMove *moveB = (const PendingMove *)b;
+    if(moveA->pid != moveB->pid) return moveA->pid < moveB->pid ? -1 : 1;
+    return moveA->order - moveB->order;
+}
+
+/* Move and resize all pending windows. Windows are grouped by application,
+ * so each application's accessibility window list is copied at most once
+ * no matter how many of its windows move.
+ */
+void MoveWindows(MoveWinCtx *ctx) {
+    AXUIElementRef appWindow;
+    PendingMove *move;
+    int i, j;
+
+    qsort(ctx->moves, ctx->numMoves, sizeof(PendingMove), compareMoves);
+    for(i = 0; i < ctx->numMoves; i = j) {
+        CF_SCOPED CFArrayRef appWindowList = NULL;
+        for(j = i; j < ctx->numMoves && ctx->moves[j].pid == ctx->moves[i].pid;
+            j++)
+        {
+            move = &ctx->moves[j];
+
+            /* Skip windows already in place, without touching the app */
+            if(!move->needsMove && !move->needsResize) continue;
+
+            /* Skip windows a concurrent movewin has since claimed */
+            if(ctx->claims && WinClaimIsSuperseded(
+                   ctx->claims,
+                   CFDictionaryGetInt(move->window, kCGWindowNumber),
+                   move->ticket))
+            {
+                continue;
+            }
+            if(!appWindowList) {
+                appWindowList = AXApplicationCopyWindows(move->pid);
+            }
+            appWindow = AXWindowFromCGWindowInList(move->window, appWindowList);
+            if(!appWindow) continue;
+
+            if(move->needsMove) AXWindowSetPosition(appWindow, move->position);
+            if(move->needsResize) AXWindowSetSize(appWindow, move->size);
+
+            /* Journal append is a fixed-size copy into a mapped file */
+            if(ctx->journaling && !ctx->journal) {
+                ctx->journal = WinJournalOpen(NULL);
+                ctx->journaling = ctx->journal != NULL;
+                ctx->batch = WinJournalBeginBatch(ctx->journal);
+                if(!ctx->journal) {
+                    fprintf(
+                        stderr, ME ": unable to open journal, "
+                        "moves cannot be undone\n"
+                    );
+                }
+            }
+            if(ctx->journal) {
+                WinJournalAppend(
+                    ctx->journal, ctx->batch, move->window,
+                    move->oldPosition, move->oldSize,
+                    move->position, move->size
+                );
+            }
         }
     }
 
-    /* Record that we moved a window, so we will skip all subsequent ones */
-    ctx->movedWindow = 1;
+    /* Record that we moved a window, even if it was already in place */
+    ctx->movedWindow = ctx->numMoves > 0;
+    free(ctx->moves);
+    ctx->moves = NULL;
+    ctx->numMoves = ctx->maxMoves = 0;
+}
+
+/* Undo (or redo) up to steps runs from the journal, against a single
+ * enumeration of windows; return true if any window was put back
+ */
+int ReplayJournal(MoveWinCtx *ctx, int undo, int steps) {
+    WinJournal *journal;
+
+    journal = WinJournalOpen(NULL);
+    if(!journal) return 0;
+    if(undo) {
+        WinJournalUndo(journal, steps, &ctx->targets, &ctx->numTargets);
+    } else {
+        WinJournalRedo(journal, steps, &ctx->targets, &ctx->numTargets);
+    }
+    WinJournalClose(journal);
+
+    /* Replayed moves are not journaled again, so they can be redone */
+    ctx->journaling = 0;
+    if(ctx->numTargets > 0) {
+        CF_SCOPED CFArrayRef windowList = CopyWindowList();
+        EnumerateWindowList(windowList, NULL, RestoreWindow, (void *)ctx);
+        MoveWindows(ctx);
+    }
+    free(ctx->targets);
+
+    return ctx->movedWindow;
 }
 
 /* Silence warning that address of _AXUIElementGetWindow is always true */
@@ -123,8 +346,17 @@ void MoveWindow(CFDictionaryRef window, void *ctxPtr) {
 
 int main(int argc, char **argv) {
     MoveWinCtx ctx;
-    int ch, negativeOffScreen = 0;
-    char *pattern = NULL;
+    int ch, negativeOffScreen = 0, hasOffset = 0, offsetX, offsetY;
+    int replayUndo = 0, replaySteps = 0;
+    char *pattern = NULL, *fuzzyQuery = NULL, *steps;
+    CF_SCOPED CFArrayRef windowList = NULL;
+    static struct option longOptions[] = {
+        { "undo", optional_argument, NULL, 'U' },
+        { "redo", optional_argument, NULL, 'R' },
+        { "snap", optional_argument, NULL, 'S' },
+        { "snap-resize", optional_argument, NULL, 'G' },
+        { NULL, 0, NULL, 0 }
+    };
 
 #define WARN(msg) { fprintf(stderr, ME ": " msg "\n"); }
 #define DIE(msg) { fprintf(stderr, ME ": " msg "\n"); exit(1); }
@@ -134,7 +366,22 @@ int main(int argc, char **argv) {
 
     /* Parse and sanitize command line arguments */
     ctx.id = -1;
-    while((ch = getopt(argc, argv, ":hni:")) != -1) {
+    ctx.allWindows = 0;
+    ctx.offset.x = ctx.offset.y = 0;
+    ctx.snap = 0;
+    ctx.snapTolerance = WINSNAP_DEFAULT_TOLERANCE;
+    ctx.snapIndex = NULL;
+    ctx.moves = NULL;
+    ctx.numMoves = ctx.maxMoves = 0;
+    ctx.targets = NULL;
+    ctx.numTargets = 0;
+    ctx.journaling = ctx.claiming = 1;
+    ctx.journal = NULL;
+    ctx.batch = 0;
+    ctx.claims = NULL;
+    ctx.movedWindow = 0;
+    while((ch = getopt_long(argc, argv, ":hnao:i:z:", longOptions, NULL)) != -1)
+    {
         switch(ch) {
             case 'h':
                  printf(FULL_USAGE);
@@ -142,12 +389,48 @@ int main(int argc, char **argv) {
             case 'n':
                 negativeOffScreen = 1;
                 break;
+            case 'a':
+                ctx.allWindows = 1;
+                break;
+            case 'o':
+                if(sscanf(optarg, "%d,%d", &offsetX, &offsetY) != 2) {
+                    DIE_USAGE("offset must be dx,dy");
+                }
+                ctx.offset.x = offsetX;
+                ctx.offset.y = offsetY;
+                hasOffset = 1;
+                break;
             case 'i':
                 if(!_AXUIElementGetWindow) {
                     DIE("unable to use window IDs for reference");
                 }
                 ctx.id = atoi(optarg);
                 break;
+            case 'z':
+                fuzzyQuery = optarg;
+                break;
+            case 'U':
+            case 'R':
+                /* Step count may be --undo=n or a separate --undo n */
+                steps = optarg;
+                if(!steps && optind < argc && isdigit(*argv[optind])) {
+                    steps = argv[optind++];
+                }
+                replaySteps = steps ? atoi(steps) : 1;
+                if(replaySteps <= 0) {
+                    DIE_USAGE("steps must be positive integer");
+                }
+                replayUndo = (ch == 'U');
+                break;
+            case 'S':
+            case 'G':
+                /* Tolerance must be --snap=px, x y may follow the option */
+                ctx.snap = (ch == 'S') ? SNAP_MOVE : SNAP_RESIZE;
+                if(optarg) ctx.snapTolerance = atof(optarg);
+                if(ctx.snapTolerance < 0) {
+                    DIE_USAGE("snap tolerance must not be negative");
+                }
+                break;
             case ':':
                 DIE_OPT("option requires an argument");
             default:
@@ -156,17 +439,38 @@ int main(int argc, char **argv) {
     }
     argc -= optind;
     argv += optind;
-    if(ctx.id == -1) {
+    if(hasOffset && !ctx.allWindows) DIE_USAGE("offset requires -a");
+
+    /* Undo or redo earlier moves instead of moving windows by title */
+    if(replaySteps > 0) {
+        if(argc > 0) WARN("ignoring extraneous arguments");
+        if(!isAuthorizedForScreenRecordingCached(AUTH_CACHE_TTL)) {
+            DIE("not authorized to do screen recording");
+        }
+        if(!isAuthorizedForAccessibility()) {
+            DIE("not authorized to use accessibility API");
+        }
+        if(ReplayJournal(&ctx, replayUndo, replaySteps)) return 0;
+        if(!recheckAuthorizedForScreenRecording(NULL)) {
+            DIE("not authorized to do screen recording");
+        }
+        return 1;
+    }
+
+    if(ctx.id == -1 && !fuzzyQuery) {
         if(argc < 1) DIE_USAGE("missing required window title");
         pattern = argv[0];
         if(!pattern || !*pattern) DIE_USAGE("missing required window title");
         argc--;
         argv++;
     }
-    if(argc < 2) DIE_USAGE("missing required window x and y coordinates");
-    ctx.position.x = atoi(argv[0]);
-    ctx.position.y = atoi(argv[1]);
-    if(negativeOffScreen) {
+    ctx.hasPosition = argc > 0 || !ctx.snap;
+    if(ctx.hasPosition && argc < 2) {
+        DIE_USAGE("missing required window x and y coordinates");
+    }
+    ctx.position.x = ctx.hasPosition ? atoi(argv[0]) : 0;
+    ctx.position.y = ctx.hasPosition ? atoi(argv[1]) : 0;
+    if(negativeOffScreen || !ctx.hasPosition) {
         ctx.fromRight = ctx.fromBottom = 0;
     } else {
         ctx.fromRight = startsWithMinus(argv[0]);
@@ -174,8 +478,10 @@ int main(int argc, char **argv) {
         ctx.position.x = fabs(ctx.position.x);
         ctx.position.y = fabs(ctx.position.y);
     }
-    argc -= 2;
-    argv += 2;
+    if(ctx.hasPosition) {
+        argc -= 2;
+        argv += 2;
+    }
     if(argc == 1) DIE_USAGE("height is required if width is present");
     if(argc > 1) {
         ctx.size.width = atoi(argv[0]);
@@ -191,15 +497,39 @@ int main(int argc, char **argv) {
     argv += 2;
     if(argc > 0) WARN("ignoring extraneous arguments");
 
-    /* Die if we are not authorized to do screen recording */
-    if(!isAuthorizedForScreenRecording()) DIE("not authorized to do screen recording");
+    /* Die if we are not authorized to do screen recording; a recent positive
+     * answer is trusted without probing, and rechecked if nothing matches
+     * and the window list looks like permission was revoked
+     */
+    if(!isAuthorizedForScreenRecordingCached(AUTH_CACHE_TTL)) {
+        DIE("not authorized to do screen recording");
+    }
 
     /* Die if we are not authorized to use OS X accessibility */
     if(!isAuthorizedForAccessibility()) DIE("not authorized to use accessibility API");
 
-    /* Try to move a window */
-    ctx.movedWindow = 0;
-    EnumerateWindows(pattern, MoveWindow, (void *)&ctx);
+    /* Find windows to move, the best match first if fuzzy matching; the
+     * window list must outlive MoveWindows(), which borrows from it
+     */
+    windowList = CopyWindowList();
+    if(ctx.snap) ctx.snapIndex = WinSnapIndexCreateFromWindowList(windowList);
+    if(fuzzyQuery) {
+        EnumerateWindowListFuzzy(
+            windowList, fuzzyQuery, (ctx.id == -1 && !ctx.allWindows) ? 1 : 0,
+            MoveWindow, (void *)&ctx
+        );
+    } else {
+        EnumerateWindowList(windowList, pattern, MoveWindow, (void *)&ctx);
+    }
+
+    /* Move them, one application at a time */
+    MoveWindows(&ctx);
+    WinSnapIndexDestroy(ctx.snapIndex);
+    WinJournalClose(ctx.journal);
+    WinClaimClose(ctx.claims);
+    if(!ctx.movedWindow && !recheckAuthorizedForScreenRecording(windowList)) {
+        DIE("not authorized to do screen recording");
+    }
 
     /* Return success if we moved any window, failure otherwise */
     return ctx.movedWindow ? 0 : 1;
@@ -0,0 +1,198 @@
+/* ========================================================================
+ * winclaim.c - shared table of window claims between movewin processes
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sys/mman.h>
+#include <sys/time.h>
+#include "winclaim.h"
+#include "winshm.h"
+
+/* Return current time in milliseconds */
+static int64_t nowMsec() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* Pack and unpack slot claims */
+#define CLAIM(windowId, ticket) (((uint64_t)(windowId) << 32) | (ticket))
+#define CLAIM_WINDOW(claim) ((CGWindowID)((claim) >> 32))
+#define CLAIM_TICKET(claim) ((uint32_t)(claim))
+
+/* Return true if ticket a was issued after ticket b, allowing wraparound */
+static int isNewer(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+/* First slot to probe for a window */
+static unsigned int slotFor(CGWindowID windowId) {
+    return (windowId * 2654435761u) % WINCLAIM_SLOTS;
+}
+
+/* Map named claim table, or the one named by $MOVEWIN_CLAIMS or
+ * WINCLAIM_DEFAULT_NAME if name is NULL, creating it if needed (NULL on
+ * error)
+ */
+WinClaimTable *WinClaimOpen(const char *name) {
+    WinClaimTable *table;
+    unsigned int magic = 0;
+
+    if(!name) name = getenv(WINCLAIM_ENV);
+    if(!name || !*name) name = WINCLAIM_DEFAULT_NAME;
+    table = (WinClaimTable *)WinShmMap(name, sizeof(WinClaimTable), 1);
+    if(!table) return NULL;
+
+    /* A new table is all zeros, which is already empty; just stamp it */
+    if(atomic_compare_exchange_strong(&table->magic, &magic, WINCLAIM_MAGIC))
+    {
+        atomic_store(&table->version, WINCLAIM_VERSION);
+    } else if(magic != WINCLAIM_MAGIC ||
+              atomic_load(&table->version) != WINCLAIM_VERSION)
+    {
+        WinClaimClose(table);
+        return NULL;
+    }
+
+    return table;
+}
+
+/* Unmap claim table */
+void WinClaimClose(WinClaimTable *table) {
+    if(table) munmap((void *)table, sizeof(WinClaimTable));
+}
+
+/* Record ticket in slot if it holds windowId, or if takeOver and it is
+ * free or its lease has run out; return false if the slot is not usable
+ */
+static int claimSlot(
+    WinClaimSlot *slot,
+    CGWindowID windowId,
+    uint32_t ticket,
+    int64_t now,
+    int takeOver
+) {
+    uint64_t claim = atomic_load(&slot->claim);
+
+    while(1) {
+
+        /* Window already has the slot, replace its claim unless newer */
+        if(CLAIM_WINDOW(claim) == windowId) {
+            if(!isNewer(ticket, CLAIM_TICKET(claim))) return 1;
+
+        /* Take over a free slot, or one whose lease has run out */
+        } else if(!takeOver || (CLAIM_WINDOW(claim) != 0 &&
+                                atomic_load(&slot->expires) >= now))
+        {
+            return 0;
+        }
+
+        atomic_store(&slot->expires, now + WINCLAIM_LEASE_MSEC);
+        if(atomic_compare_exchange_weak(
+               &slot->claim, &claim, CLAIM(windowId, ticket)))
+        {
+            return 1;
+        }
+    }
+}
+
+/* Claim window for a write, return ticket identifying this claim. The
+ * slot for the window keeps only the newest ticket, so of several
+ * processes racing to move the same window, the last one to claim it wins.
+ * If the table is full the claim is not recorded, and nobody is skipped.
+ *
+ * Slots are never emptied, only taken over, so the window's slot may lie
+ * past an expired one anywhere up to the first free slot; the whole chain
+ * is searched before taking one over. Two processes can still each take
+ * over a slot for a window new to the table, which is why
+ * WinClaimIsSuperseded() looks at every slot in the chain.
+ *
+ * The lease does not fit in the compare-and-swap word with the claim, so
+ * it is stored first: once the claim is visible its lease is too, and no
+ * other window can take over the slot while it is fresh. If the swap then
+ * fails, the slot's current claim is left with the lease just written,
+ * which is off from its own by no more than WINCLAIM_LEASE_MSEC; that only
+ * changes when the slot can next be reused, never who holds it.
+ */
+uint32_t WinClaimTake(WinClaimTable *table, CGWindowID windowId) {
+    WinClaimSlot *slot;
+    uint32_t ticket;
+    int64_t now;
+    int probe;
+
+    do {
+        ticket = atomic_fetch_add(&table->nextTicket, 1) + 1;
+    } while(ticket == 0);
+    now = nowMsec();
+
+    for(probe = 0; probe < WINCLAIM_SLOTS; probe++) {
+        slot = &table->slots[(slotFor(windowId) + probe) % WINCLAIM_SLOTS];
+        if(CLAIM_WINDOW(atomic_load(&slot->claim)) == 0) break;
+        if(claimSlot(slot, windowId, ticket, now, 0)) return ticket;
+    }
+    for(probe = 0; probe < WINCLAIM_SLOTS; probe++) {
+        slot = &table->slots[(slotFor(windowId) + probe) % WINCLAIM_SLOTS];
+        if(claimSlot(slot, windowId, ticket, now, 1)) return ticket;
+    }
+
+    return ticket;
+}
+
+/* Return true if a newer claim was taken on window since ticket was */
+int WinClaimIsSuperseded(
+    WinClaimTable *table,
+    CGWindowID windowId,
+    uint32_t ticket
+) {
+    uint64_t claim;
+    int probe;
+
+    for(probe = 0; probe < WINCLAIM_SLOTS; probe++) {
+        claim = atomic_load(&table->slots[
+            (slotFor(windowId) + probe) % WINCLAIM_SLOTS
+        ].claim);
+        if(CLAIM_WINDOW(claim) == 0) break;
+        if(CLAIM_WINDOW(claim) == windowId &&
+           isNewer(CLAIM_TICKET(claim), ticket))
+        {
+            atomic_fetch_add(&table->superseded, 1);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* ======================================================================== */
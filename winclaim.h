@@ -0,0 +1,94 @@
+/* ========================================================================
+ * winclaim.h - shared table of window claims between movewin processes
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINCLAIM_H
+#define WINCLAIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "winutils.h"
+
+#define WINCLAIM_ENV "MOVEWIN_CLAIMS"
+#define WINCLAIM_DEFAULT_NAME "/movewin.claims"
+#define WINCLAIM_MAGIC 0x6c63776d  /* "mwcl" */
+#define WINCLAIM_VERSION 1
+#define WINCLAIM_SLOTS 256
+#define WINCLAIM_LEASE_MSEC 2000
+
+/* Window ID in the high 32 bits, ticket of latest claim in the low 32 */
+typedef struct {
+    _Atomic uint64_t claim;
+    _Atomic int64_t expires;   /* msec since the epoch, slot reusable after */
+} WinClaimSlot;
+
+/* Shared memory layout; an all zero table is a valid, empty one */
+typedef struct {
+    atomic_uint magic;
+    atomic_uint version;
+    atomic_uint nextTicket;
+    atomic_uint superseded;    /* writes skipped because of a newer claim */
+    WinClaimSlot slots[WINCLAIM_SLOTS];
+} WinClaimTable;
+
+/* Map named claim table, or the one named by $MOVEWIN_CLAIMS or
+ * WINCLAIM_DEFAULT_NAME if name is NULL, creating it if needed (NULL on
+ * error)
+ */
+WinClaimTable *WinClaimOpen(const char *name);
+void WinClaimClose(WinClaimTable *table);
+
+/* Claim window for a write, return ticket identifying this claim */
+uint32_t WinClaimTake(WinClaimTable *table, CGWindowID windowId);
+
+/* Return true if a newer claim was taken on window since ticket was */
+int WinClaimIsSuperseded(
+    WinClaimTable *table,
+    CGWindowID windowId,
+    uint32_t ticket
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINCLAIM_H */
+
+
+/* ======================================================================== */
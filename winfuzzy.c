@@ -0,0 +1,389 @@
+/* ========================================================================
+ * winfuzzy.c - ranked fuzzy search of window titles
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#if !defined(WINFUZZY_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#elif !defined(WINFUZZY_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#elif !defined(WINFUZZY_SCALAR) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "winfuzzy.h"
+#include "winutf8.h"
+
+/* Scoring weights, loosely following fzf: every matched character is
+ * worth SCORE_MATCH, gaps between matches cost a little, and matches at
+ * word boundaries or right after the previous match earn a bonus
+ */
+#define SCORE_MATCH 16
+#define SCORE_GAP_START -3
+#define SCORE_GAP_EXTENSION -1
+#define BONUS_BOUNDARY 8
+#define BONUS_CONSECUTIVE 4
+#define BONUS_FIRST_CHAR_MULTIPLIER 2
+
+/* ASCII-only case folding, so UTF-8 continuation bytes are left alone */
+static inline unsigned char foldCase(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/* Return index of first character in s[from, len) equal to c ignoring
+ * case, or -1; this is the hot loop, so scan a vector at a time
+ */
+static long findChar(const char *s, size_t len, size_t from, unsigned char c) {
+    unsigned char lower = foldCase(c);
+    unsigned char upper = (lower >= 'a' && lower <= 'z') ?
+        lower - ('a' - 'A') : lower;
+    size_t i = from;
+
+#if !defined(WINFUZZY_SCALAR) && defined(__AVX2__)
+    __m256i lo32 = _mm256_set1_epi8((char)lower);
+    __m256i up32 = _mm256_set1_epi8((char)upper);
+    for(; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(v, lo32), _mm256_cmpeq_epi8(v, up32)
+        ));
+        if(mask) return i + __builtin_ctz(mask);
+    }
+#endif
+#if !defined(WINFUZZY_SCALAR) && (defined(__AVX2__) || defined(__SSE2__))
+    __m128i lo16 = _mm_set1_epi8((char)lower);
+    __m128i up16 = _mm_set1_epi8((char)upper);
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(v, lo16), _mm_cmpeq_epi8(v, up16)
+        ));
+        if(mask) return i + __builtin_ctz(mask);
+    }
+#elif !defined(WINFUZZY_SCALAR) && defined(__ARM_NEON)
+    uint8x16_t lo16 = vdupq_n_u8(lower);
+    uint8x16_t up16 = vdupq_n_u8(upper);
+    for(; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)(s + i));
+        uint8x16_t eq = vorrq_u8(vceqq_u8(v, lo16), vceqq_u8(v, up16));
+        /* Narrow each byte of the comparison to a nibble of a 64-bit mask */
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)
+        ), 0);
+        if(mask) return i + (__builtin_ctzll(mask) >> 2);
+    }
+#endif
+
+    for(; i < len; i++) {
+        if((unsigned char)s[i] == lower || (unsigned char)s[i] == upper) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Return true if position i in s starts a word */
+static int isWordStart(const char *s, size_t i) {
+    unsigned char prev, cur;
+    if(i == 0) return 1;
+    prev = s[i - 1];
+    cur = s[i];
+    if(!isalnum(prev) && prev < 0x80) return 1;
+    if(islower(prev) && isupper(cur)) return 1;
+    if(!isdigit(prev) && isdigit(cur)) return 1;
+    return 0;
+}
+
+/* Score title (of given length) against query, higher is better, and never
+ * below 0 for a match; return FUZZY_NO_MATCH if query characters do not
+ * appear in order in title
+ */
+int FuzzyScore(const char *query, const char *title, size_t titleLen) {
+    size_t queryLen = strlen(query), i, j, start, end;
+    long found;
+    int score, bonus, inGap;
+
+    if(queryLen == 0) return 0;
+
+    /* Find where the earliest in-order match of query ends */
+    end = 0;
+    for(i = j = 0; j < queryLen; j++) {
+        found = findChar(title, titleLen, i, query[j]);
+        if(found < 0) return FUZZY_NO_MATCH;
+        end = found;
+        i = found + 1;
+    }
+
+    /* Walk back from there to find the latest start, i.e. tightest match */
+    start = end;
+    for(i = end + 1, j = queryLen; j > 0 && i > 0; i--) {
+        if(foldCase(title[i - 1]) == foldCase(query[j - 1])) {
+            start = i - 1;
+            j--;
+        }
+    }
+
+    /* Score the matched span */
+    score = 0;
+    inGap = 0;
+    for(i = start, j = 0; i <= end && j < queryLen; i++) {
+        if(foldCase(title[i]) == foldCase(query[j])) {
+            bonus = isWordStart(title, i) ? BONUS_BOUNDARY : 0;
+            if(j > 0 && !inGap && bonus < BONUS_CONSECUTIVE) {
+                bonus = BONUS_CONSECUTIVE;
+            }
+            if(j == 0) bonus *= BONUS_FIRST_CHAR_MULTIPLIER;
+            score += SCORE_MATCH + bonus;
+            inGap = 0;
+            j++;
+        } else {
+            score += inGap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+            inGap = 1;
+        }
+    }
+
+    /* Long gaps can outweigh the matches, but a match is still a match */
+    return score > 0 ? score : 0;
+}
+
+/* One candidate window, with the score of its title */
+typedef struct {
+    int score;
+    int index;             /* enumeration order, front to back */
+} FuzzyMatch;
+
+/* Windows collected from one enumeration, borrowed from its window list,
+ * with names borrowed from its batch of converted names
+ */
+typedef struct {
+    CFDictionaryRef *windows;
+    char **appNames, **windowNames;
+    char **titles;
+    int count, capacity;
+} FuzzyCandidates;
+
+/* Window callback and its data, for EnumerateWindowListFuzzy() to pass on */
+typedef struct {
+    void(*callback)(CFDictionaryRef window, void *callback_data);
+    void *callback_data;
+} WindowCallback;
+
+/* Callback for EnumerateWindowListNames() keeps each listed window, its
+ * names, and its title
+ */
+static void AddCandidate(
+    CFDictionaryRef window,
+    char *appName,
+    char *windowName,
+    void *candidatesPtr
+) {
+    FuzzyCandidates *candidates = (FuzzyCandidates *)candidatesPtr;
+
+    if(candidates->count == candidates->capacity) {
+        candidates->capacity =
+            candidates->capacity ? candidates->capacity * 2 : 64;
+        candidates->windows = (CFDictionaryRef *)realloc(
+            candidates->windows,
+            candidates->capacity * sizeof(CFDictionaryRef)
+        );
+        candidates->appNames = (char **)realloc(
+            candidates->appNames, candidates->capacity * sizeof(char *)
+        );
+        candidates->windowNames = (char **)realloc(
+            candidates->windowNames, candidates->capacity * sizeof(char *)
+        );
+        candidates->titles = (char **)realloc(
+            candidates->titles, candidates->capacity * sizeof(char *)
+        );
+    }
+    candidates->windows[candidates->count] = window;
+    candidates->appNames[candidates->count] = appName;
+    candidates->windowNames[candidates->count] = windowName;
+    candidates->titles[candidates->count] = windowTitle(appName, windowName);
+    candidates->count++;
+}
+
+/* Return true if match a should rank ahead of match b */
+static int isBetterMatch(const FuzzyMatch *a, const FuzzyMatch *b) {
+    return a->score > b->score || (a->score == b->score && a->index < b->index);
+}
+
+/* Order matches best first, for qsort() */
+static int compareMatches(const void *a, const void *b) {
+    return isBetterMatch((const FuzzyMatch *)a, (const FuzzyMatch *)b) ? -1 :
+           isBetterMatch((const FuzzyMatch *)b, (const FuzzyMatch *)a) ? 1 : 0;
+}
+
+/* Restore heap order below i, where the worst match is at the root */
+static void siftDown(FuzzyMatch *heap, int count, int i) {
+    FuzzyMatch tmp;
+    int child;
+
+    while((child = 2 * i + 1) < count) {
+        if(child + 1 < count && isBetterMatch(&heap[child], &heap[child + 1])) {
+            child++;
+        }
+        if(!isBetterMatch(&heap[i], &heap[child])) break;
+        tmp = heap[i];
+        heap[i] = heap[child];
+        heap[child] = tmp;
+        i = child;
+    }
+}
+
+/* Score every window against query, run callback on best k matches (all
+ * matches if k <= 0) from best to worst, return number of matches
+ */
+int EnumerateWindowsFuzzy(
+    char *query,
+    int k,
+    void(*callback)(CFDictionaryRef window, void *callback_data),
+    void *callback_data
+) {
+    CF_SCOPED CFArrayRef windowList = CopyWindowList();
+    return EnumerateWindowListFuzzy(
+        windowList, query, k, callback, callback_data
+    );
+}
+
+/* Callback for EnumerateWindowListFuzzyNames() that drops the names */
+static void CallWithoutNames(
+    CFDictionaryRef window,
+    char *appName,
+    char *windowName,
+    void *windowCallbackPtr
+) {
+    WindowCallback *windowCallback = (WindowCallback *)windowCallbackPtr;
+    if(windowCallback->callback) {
+        (*windowCallback->callback)(window, windowCallback->callback_data);
+    }
+}
+
+/* Like EnumerateWindowsFuzzy(), but search a window list the caller owns */
+int EnumerateWindowListFuzzy(
+    CFArrayRef windowList,
+    char *query,
+    int k,
+    void(*callback)(CFDictionaryRef window, void *callback_data),
+    void *callback_data
+) {
+    WindowCallback windowCallback = { callback, callback_data };
+    return EnumerateWindowListFuzzyNames(
+        windowList, query, k, CallWithoutNames, (void *)&windowCallback
+    );
+}
+
+/* Like EnumerateWindowListFuzzy(), but pass names on too; the batch of
+ * converted names is kept until every callback has run
+ */
+int EnumerateWindowListFuzzyNames(
+    CFArrayRef windowList,
+    char *query,
+    int k,
+    void(*callback)(
+        CFDictionaryRef window,
+        char *appName,
+        char *windowName,
+        void *callback_data
+    ),
+    void *callback_data
+) {
+    FuzzyCandidates candidates;
+    FuzzyMatch *heap, match;
+    char **names, *buffer;
+    int i, j, count, score;
+
+    if(!windowList) return 0;
+    names = (char **)malloc(
+        (2 * CFArrayGetCount(windowList) + 1) * sizeof(char *)
+    );
+    if(!names) return -1;
+    buffer = WindowListCopyNames(windowList, names);
+    if(!buffer) {
+        free(names);
+        return -1;
+    }
+    memset(&candidates, 0, sizeof(candidates));
+    EnumerateWindowListNames(
+        windowList, names, NULL, AddCandidate, (void *)&candidates
+    );
+    if(k <= 0 || k > candidates.count) k = candidates.count;
+
+    /* Keep the best k matches in a heap with the worst of them on top */
+    heap = (FuzzyMatch *)malloc((k + 1) * sizeof(FuzzyMatch));
+    count = 0;
+    for(i = 0; i < candidates.count; i++) {
+        score = FuzzyScore(
+            query ? query : "", candidates.titles[i],
+            strlen(candidates.titles[i])
+        );
+        if(score == FUZZY_NO_MATCH) continue;
+        match.score = score;
+        match.index = i;
+        if(count < k) {
+            heap[count++] = match;
+            if(count == k) {
+                for(j = k / 2 - 1; j >= 0; j--) siftDown(heap, count, j);
+            }
+        } else if(k > 0 && isBetterMatch(&match, &heap[0])) {
+            heap[0] = match;
+            siftDown(heap, count, 0);
+        }
+    }
+
+    /* Only the k survivors need a full sort */
+    qsort(heap, count, sizeof(FuzzyMatch), compareMatches);
+    if(callback) {
+        for(i = 0; i < count; i++) {
+            j = heap[i].index;
+            (*callback)(
+                candidates.windows[j], candidates.appNames[j],
+                candidates.windowNames[j], callback_data
+            );
+        }
+    }
+
+    for(i = 0; i < candidates.count; i++) free(candidates.titles[i]);
+    free(candidates.windows);
+    free(candidates.appNames);
+    free(candidates.windowNames);
+    free(candidates.titles);
+    free(heap);
+    free(buffer);
+    free(names);
+
+    return count;
+}
+
+
+/* ======================================================================== */
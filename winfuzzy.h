@@ -0,0 +1,101 @@
+/* ========================================================================
+ * winfuzzy.h - ranked fuzzy search of window titles
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINFUZZY_H
+#define WINFUZZY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "winutils.h"
+
+/* Returned by FuzzyScore() when title does not match at all */
+#define FUZZY_NO_MATCH -1
+
+/* Score title (of given length) against query, higher is better, and never
+ * below 0 for a match; return FUZZY_NO_MATCH if query characters do not
+ * appear in order in title
+ */
+int FuzzyScore(const char *query, const char *title, size_t titleLen);
+
+/* Score every window against query, run callback on best k matches (all
+ * matches if k <= 0) from best to worst, return number of matches
+ */
+int EnumerateWindowsFuzzy(
+    char *query,
+    int k,
+    void(*callback)(CFDictionaryRef window, void *callback_data),
+    void *callback_data
+);
+
+/* Like EnumerateWindowsFuzzy(), but search a window list the caller owns;
+ * window dictionaries passed to callback stay valid as long as the list
+ */
+int EnumerateWindowListFuzzy(
+    CFArrayRef windowList,
+    char *query,
+    int k,
+    void(*callback)(CFDictionaryRef window, void *callback_data),
+    void *callback_data
+);
+
+/* Like EnumerateWindowListFuzzy(), but also pass callback the owner and
+ * window name the window was scored by, converted with the rest of the
+ * list in one batch (valid only during the call); return -1 if out of
+ * memory
+ */
+int EnumerateWindowListFuzzyNames(
+    CFArrayRef windowList,
+    char *query,
+    int k,
+    void(*callback)(
+        CFDictionaryRef window,
+        char *appName,
+        char *windowName,
+        void *callback_data
+    ),
+    void *callback_data
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINFUZZY_H */
+
+
+/* ======================================================================== */
@@ -0,0 +1,847 @@
+/* ========================================================================
+ * winhistory.c - compact log of where windows were over time
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "winhistory.h"
+
+/* On disk layout: a WinHistoryHeader, then frames back to back. A frame
+ * is a 32-bit little endian payload length followed by the payload:
+ *
+ *   flags           FRAME_KEY, FRAME_SAME_IDS
+ *   time            milliseconds since the epoch in a keyframe, otherwise
+ *                   milliseconds since the previous frame
+ *   numStrings      strings added to the title dictionary, each a length
+ *                   then its bytes; a keyframe starts a new dictionary
+ *   count           windows in the sample
+ *   ID column       count window IDs in ascending order, each as the
+ *                   difference from the one before, unless FRAME_SAME_IDS
+ *   change masks    one bit per field, per window in ID order, run length
+ *                   coded as a count of unchanged windows, then a mask
+ *   field columns   for each field in order, the difference from that
+ *                   window's previous sample (zero for a new window or in
+ *                   a keyframe) of every window whose mask has the bit set
+ *
+ * Every number is an unsigned LEB128 varint, and differences are zigzag
+ * coded first, so a window that did not move costs well under a byte.
+ *
+ * Beside the log, path.idx holds an IndexEntry for every keyframe, so a
+ * query can binary search for where to start decoding instead of reading
+ * every frame header from the start. It is only a hint: entries are
+ * checked against the log, and without one the log is read from the top.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+} WinHistoryHeader;
+
+/* Keyframe index entry. Frame times can step backwards at a keyframe, but
+ * reach, the latest time of any frame up to and including this keyframe,
+ * never does; a query for time starts at the last keyframe whose reach is
+ * at or before time, which reading from the top would also have reached.
+ */
+typedef struct {
+    int64_t reach;
+    int64_t time;             /* keyframe time, to check entry against log */
+    uint64_t offset;          /* of keyframe in log */
+} IndexEntry;
+
+#define FRAME_KEY 1
+#define FRAME_SAME_IDS 2
+#define NO_STRING ((size_t)-1)
+
+/* Per window fields, in column order; names are dictionary indexes */
+enum {
+    FIELD_APP_NAME, FIELD_WINDOW_NAME, FIELD_X, FIELD_Y, FIELD_WIDTH,
+    FIELD_HEIGHT, FIELD_ORDER, FIELD_PID, FIELD_LAYER, NUM_FIELDS
+};
+
+/* One window of a sample, as encoded */
+typedef struct {
+    uint32_t id;
+    int32_t fields[NUM_FIELDS];
+} HistoryWindow;
+
+/* Growable byte buffer */
+typedef struct {
+    unsigned char *bytes;
+    size_t len, capacity;
+} Buffer;
+
+struct WinHistory {
+    int fd;
+    int writable;
+
+    /* Keyframe index beside the log (-1 if none), and latest frame time */
+    char *indexPath;
+    int indexFd;
+    int64_t maxTime;
+
+    /* Last sample written or decoded, and room for the next one */
+    HistoryWindow *last, *next;
+    int lastCount, capacity;
+    int *scratch;             /* per window previous index, or change mask */
+    int64_t lastTime;
+    int framesSinceKey;       /* -1 forces a keyframe */
+
+    /* Recording: dictionary strings, and the frame being encoded */
+    char **dict;
+    int dictCount, dictCapacity, dictWritten;
+    int *dictHash;            /* open addressing, dict index or -1 */
+    int hashCapacity;
+    Buffer frame;
+
+    /* Queries: mapped log, dictionary strings and sample titles */
+    unsigned char *map;
+    size_t mapLen;
+    size_t *dictOffsets;
+    Buffer strings, titles;
+};
+
+/* Make sure buffer has room for len more bytes */
+static void reserve(Buffer *buffer, size_t len) {
+    if(buffer->len + len <= buffer->capacity) return;
+    while(buffer->len + len > buffer->capacity) {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+    }
+    buffer->bytes = (unsigned char *)realloc(buffer->bytes, buffer->capacity);
+}
+
+static void putBytes(Buffer *buffer, const void *bytes, size_t len) {
+    reserve(buffer, len);
+    memcpy(buffer->bytes + buffer->len, bytes, len);
+    buffer->len += len;
+}
+
+static void putVarint(Buffer *buffer, uint64_t value) {
+    reserve(buffer, 10);
+    while(value >= 0x80) {
+        buffer->bytes[buffer->len++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    buffer->bytes[buffer->len++] = (unsigned char)value;
+}
+
+/* Read varint at *p (not past end) into value, return -1 if truncated */
+static int getVarint(
+    const unsigned char **p,
+    const unsigned char *end,
+    uint64_t *value
+) {
+    int shift;
+
+    *value = 0;
+    for(shift = 0; *p < end && shift < 64; shift += 7) {
+        unsigned char byte = *(*p)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) return 0;
+    }
+    return -1;
+}
+
+static inline uint64_t zigzag(int64_t n) {
+    return ((uint64_t)n << 1) ^ (uint64_t)(n >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t n) {
+    return (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+}
+
+/* Sort sample windows by window ID */
+static int compareById(const void *a, const void *b) {
+    uint32_t idA = ((const HistoryWindow *)a)->id;
+    uint32_t idB = ((const HistoryWindow *)b)->id;
+    return (idA > idB) - (idA < idB);
+}
+
+/* Sort sample windows front to back */
+static int compareByOrder(const void *a, const void *b) {
+    int32_t orderA = ((const HistoryWindow *)a)->fields[FIELD_ORDER];
+    int32_t orderB = ((const HistoryWindow *)b)->fields[FIELD_ORDER];
+    return (orderA > orderB) - (orderA < orderB);
+}
+
+/* FNV-1a, for the dictionary */
+static uint32_t hashString(const char *s) {
+    uint32_t hash = 2166136261u;
+    while(*s) hash = (hash ^ (unsigned char)*s++) * 16777619u;
+    return hash;
+}
+
+/* Forget every dictionary string, as at the start of a keyframe */
+static void resetDictionary(WinHistory *history) {
+    int i;
+
+    if(history->dict) {
+        for(i = 0; i < history->dictCount; i++) free(history->dict[i]);
+    }
+    history->dictCount = history->dictWritten = 0;
+    for(i = 0; i < history->hashCapacity; i++) history->dictHash[i] = -1;
+}
+
+/* Return dictionary index of s, adding it if not already there */
+static int internString(WinHistory *history, const char *s) {
+    uint32_t mask, slot;
+    int i, *hash;
+
+    if(!s) s = "";
+
+    /* Keep the hash table at most half full */
+    if(2 * (history->dictCount + 1) > history->hashCapacity) {
+        free(history->dictHash);
+        history->hashCapacity =
+            history->hashCapacity ? history->hashCapacity * 2 : 256;
+        history->dictHash = (int *)malloc(history->hashCapacity * sizeof(int));
+        mask = history->hashCapacity - 1;
+        for(i = 0; i < history->hashCapacity; i++) history->dictHash[i] = -1;
+        for(i = 0; i < history->dictCount; i++) {
+            slot = hashString(history->dict[i]) & mask;
+            while(history->dictHash[slot] != -1) slot = (slot + 1) & mask;
+            history->dictHash[slot] = i;
+        }
+    }
+
+    mask = history->hashCapacity - 1;
+    hash = history->dictHash;
+    for(slot = hashString(s) & mask; hash[slot] != -1; slot = (slot + 1) & mask)
+    {
+        if(strcmp(history->dict[hash[slot]], s) == 0) return hash[slot];
+    }
+
+    if(history->dictCount == history->dictCapacity) {
+        history->dictCapacity =
+            history->dictCapacity ? history->dictCapacity * 2 : 256;
+        history->dict = (char **)realloc(
+            history->dict, history->dictCapacity * sizeof(char *)
+        );
+    }
+    history->dict[history->dictCount] = strdup(s);
+    hash[slot] = history->dictCount;
+    return history->dictCount++;
+}
+
+/* Map log for reading, again if it has grown since the last query */
+static int mapLog(WinHistory *history) {
+    struct stat st;
+
+    if(fstat(history->fd, &st) == -1) return -1;
+    if(history->map != MAP_FAILED) {
+        if((size_t)st.st_size == history->mapLen) return 0;
+        munmap(history->map, history->mapLen);
+    }
+    history->mapLen = st.st_size;
+    history->map = (unsigned char *)mmap(
+        NULL, history->mapLen, PROT_READ, MAP_SHARED, history->fd, 0
+    );
+    return history->map == MAP_FAILED ? -1 : 0;
+}
+
+/* Find frame at offset pos, set its payload bounds, flags and time
+ * (given time of the frame before); return offset of the following
+ * frame, or 0 if there is no complete frame at pos
+ */
+static size_t readFrameHeader(
+    WinHistory *history,
+    size_t pos,
+    const unsigned char **payload,
+    const unsigned char **end,
+    uint64_t *flags,
+    int64_t *time
+) {
+    const unsigned char *p;
+    uint64_t payloadLen, value;
+
+    if(pos + 4 > history->mapLen) return 0;
+    p = history->map + pos;
+    payloadLen = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint64_t)p[3] << 24);
+    if(payloadLen > history->mapLen - pos - 4) return 0;
+    *payload = p + 4;
+    *end = *payload + payloadLen;
+
+    p = *payload;
+    if(getVarint(&p, *end, flags) == -1) return 0;
+    if(getVarint(&p, *end, &value) == -1) return 0;
+    *time = (*flags & FRAME_KEY) ? (int64_t)value : *time + (int64_t)value;
+    return pos + 4 + payloadLen;
+}
+
+/* Return true if entry is of a keyframe in the mapped log */
+static int isIndexEntryValid(WinHistory *history, const IndexEntry *entry) {
+    const unsigned char *payload, *end;
+    uint64_t flags;
+    int64_t frameTime = 0;
+
+    if(entry->offset < sizeof(WinHistoryHeader) ||
+       entry->offset >= history->mapLen ||
+       !readFrameHeader(
+           history, entry->offset, &payload, &end, &flags, &frameTime
+       ))
+    {
+        return 0;
+    }
+    return (flags & FRAME_KEY) && frameTime == entry->time &&
+        entry->reach >= entry->time;
+}
+
+/* Read index entry i, return -1 if it is not there */
+static int readIndexEntry(WinHistory *history, off_t i, IndexEntry *entry) {
+    return pread(
+        history->indexFd, entry, sizeof(IndexEntry), i * sizeof(IndexEntry)
+    ) == sizeof(IndexEntry) ? 0 : -1;
+}
+
+/* Return offset of the frame to start a query for time from: the last
+ * indexed keyframe whose reach is at or before time, or the first frame
+ * if there is none or the index does not match the mapped log
+ */
+static size_t findKeyframe(WinHistory *history, int64_t time) {
+    IndexEntry entry;
+    struct stat st;
+    off_t low, high, mid;
+
+    /* The recorder may have started the index after we opened the log */
+    if(history->indexFd == -1) {
+        history->indexFd = open(history->indexPath, O_RDONLY);
+        if(history->indexFd == -1) return sizeof(WinHistoryHeader);
+    }
+    if(fstat(history->indexFd, &st) == -1) return sizeof(WinHistoryHeader);
+
+    /* Binary search for the first entry with reach past time */
+    low = 0;
+    high = st.st_size / sizeof(IndexEntry);
+    while(low < high) {
+        mid = low + (high - low) / 2;
+        if(readIndexEntry(history, mid, &entry) == -1) {
+            return sizeof(WinHistoryHeader);
+        }
+        if(entry.reach <= time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if(low == 0 || readIndexEntry(history, low - 1, &entry) == -1 ||
+       !isIndexEntryValid(history, &entry))
+    {
+        return sizeof(WinHistoryHeader);
+    }
+    return entry.offset;
+}
+
+/* Record keyframe at offset, taken at time, in the index; on error stop
+ * indexing, which only makes queries read more of the log
+ */
+static void appendIndexEntry(
+    WinHistory *history,
+    int64_t time,
+    off_t offset
+) {
+    IndexEntry entry;
+
+    if(history->indexFd == -1 || offset < 0) return;
+    entry.reach = history->maxTime;
+    entry.time = time;
+    entry.offset = offset;
+    if(write(history->indexFd, &entry, sizeof(entry)) != sizeof(entry)) {
+        close(history->indexFd);
+        history->indexFd = -1;
+    }
+}
+
+/* Find the latest frame time in an existing log, reading frames from the
+ * last valid index entry on, and drop any partly written index entry
+ */
+static void findMaxTime(WinHistory *history) {
+    const unsigned char *payload, *end;
+    IndexEntry entry;
+    struct stat st;
+    uint64_t flags;
+    int64_t frameTime = 0;
+    size_t pos;
+
+    if(mapLog(history) == -1) return;
+    pos = sizeof(WinHistoryHeader);
+    if(history->indexFd != -1 && fstat(history->indexFd, &st) == 0) {
+        if(st.st_size % sizeof(IndexEntry) &&
+           ftruncate(
+               history->indexFd, st.st_size - st.st_size % sizeof(IndexEntry)
+           ) == -1)
+        {
+            close(history->indexFd);
+            history->indexFd = -1;
+        } else if(st.st_size >= (off_t)sizeof(IndexEntry) &&
+                  readIndexEntry(
+                      history, st.st_size / sizeof(IndexEntry) - 1, &entry
+                  ) == 0 &&
+                  isIndexEntryValid(history, &entry))
+        {
+            pos = entry.offset;
+            history->maxTime = entry.reach;
+        }
+    }
+    while((pos = readFrameHeader(
+               history, pos, &payload, &end, &flags, &frameTime
+           )) != 0)
+    {
+        if(frameTime > history->maxTime) history->maxTime = frameTime;
+    }
+
+    munmap(history->map, history->mapLen);
+    history->map = MAP_FAILED;
+}
+
+/* Open log at path for appending samples or for queries, see winhistory.h */
+WinHistory *WinHistoryOpen(const char *path, int writable) {
+    WinHistoryHeader header;
+    WinHistory *history;
+    struct stat st;
+    int fd;
+
+    fd = writable ?
+        open(path, O_RDWR|O_CREAT|O_APPEND, 0600) : open(path, O_RDONLY);
+    if(fd == -1) return NULL;
+    if(fstat(fd, &st) == -1) {
+        close(fd);
+        return NULL;
+    }
+
+    /* A new log starts with a header, an existing one must have ours */
+    if(writable && st.st_size == 0) {
+        header.magic = WINHISTORY_MAGIC;
+        header.version = WINHISTORY_VERSION;
+        if(write(fd, &header, sizeof(header)) != sizeof(header)) {
+            close(fd);
+            return NULL;
+        }
+    } else if(pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+              header.magic != WINHISTORY_MAGIC ||
+              header.version != WINHISTORY_VERSION)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    history = (WinHistory *)calloc(1, sizeof(WinHistory));
+    history->fd = fd;
+    history->writable = writable;
+    history->framesSinceKey = -1;
+    history->map = MAP_FAILED;
+    history->indexPath = (char *)malloc(strlen(path) + 5);
+    sprintf(history->indexPath, "%s.idx", path);
+    history->indexFd = -1;
+    history->maxTime = INT64_MIN;
+
+    /* A recorder keeps the index up to date, starting it over with a new
+     * log, and needs the latest frame time so far for the next entry
+     */
+    if(writable) {
+        history->indexFd = open(
+            history->indexPath,
+            O_RDWR|O_CREAT|O_APPEND|(st.st_size == 0 ? O_TRUNC : 0), 0600
+        );
+        if(st.st_size > 0) findMaxTime(history);
+    }
+    return history;
+}
+
+/* Close log, unmapping and freeing everything */
+void WinHistoryClose(WinHistory *history) {
+    if(!history) return;
+    resetDictionary(history);
+    if(history->map != MAP_FAILED) munmap(history->map, history->mapLen);
+    close(history->fd);
+    if(history->indexFd != -1) close(history->indexFd);
+    free(history->indexPath);
+    free(history->last);
+    free(history->next);
+    free(history->dict);
+    free(history->dictHash);
+    free(history->scratch);
+    free(history->frame.bytes);
+    free(history->dictOffsets);
+    free(history->strings.bytes);
+    free(history->titles.bytes);
+    free(history);
+}
+
+/* Make room for samples of count windows */
+static void reserveWindows(WinHistory *history, int count) {
+    if(count <= history->capacity) return;
+    history->capacity = count;
+    history->last = (HistoryWindow *)realloc(
+        history->last, count * sizeof(HistoryWindow)
+    );
+    history->next = (HistoryWindow *)realloc(
+        history->next, count * sizeof(HistoryWindow)
+    );
+    history->scratch =
+        (int *)realloc(history->scratch, count * sizeof(int));
+}
+
+/* Append a sample of windows in front to back order, see winhistory.h */
+int WinHistoryAppend(
+    WinHistory *history,
+    int64_t time,
+    const WindowInfo *windows,
+    int count
+) {
+    HistoryWindow *cur, *prev, *swap;
+    int isKey, sameIds, i, j, f, run, mask, *prevIndex;
+    int64_t diff;
+    uint32_t lastId, payloadLen;
+    Buffer *frame;
+
+    if(!history || !history->writable || count < 0) return -1;
+
+    /* Keyframes come at regular intervals, and whenever the clock steps
+     * backwards, so that frame times only ever increase
+     */
+    isKey = history->framesSinceKey < 0 ||
+        history->framesSinceKey + 1 >= WINHISTORY_KEYFRAME_INTERVAL ||
+        time < history->lastTime;
+    if(isKey) {
+        resetDictionary(history);
+        history->lastCount = 0;
+    }
+
+    /* Turn windows into encoded form, sorted by ID */
+    reserveWindows(history, count);
+    cur = history->next;
+    prev = history->last;
+    for(i = 0; i < count; i++) {
+        cur[i].id = windows[i].id;
+        cur[i].fields[FIELD_APP_NAME] =
+            internString(history, windows[i].appName);
+        cur[i].fields[FIELD_WINDOW_NAME] =
+            internString(history, windows[i].windowName);
+        cur[i].fields[FIELD_X] = (int32_t)windows[i].bounds.origin.x;
+        cur[i].fields[FIELD_Y] = (int32_t)windows[i].bounds.origin.y;
+        cur[i].fields[FIELD_WIDTH] = (int32_t)windows[i].bounds.size.width;
+        cur[i].fields[FIELD_HEIGHT] = (int32_t)windows[i].bounds.size.height;
+        cur[i].fields[FIELD_ORDER] = i;
+        cur[i].fields[FIELD_PID] = windows[i].pid;
+        cur[i].fields[FIELD_LAYER] = windows[i].layer;
+    }
+    qsort(cur, count, sizeof(HistoryWindow), compareById);
+
+    /* Find each window's previous sample by walking both ID ordered
+     * samples together
+     */
+    prevIndex = history->scratch;
+    sameIds = !isKey && count == history->lastCount;
+    for(i = 0, j = 0; i < count; i++) {
+        while(j < history->lastCount && prev[j].id < cur[i].id) j++;
+        prevIndex[i] =
+            (j < history->lastCount && prev[j].id == cur[i].id) ? j : -1;
+        if(prevIndex[i] != i) sameIds = 0;
+    }
+
+    /* Frame header, new dictionary strings, and the ID column */
+    frame = &history->frame;
+    frame->len = 0;
+    putBytes(frame, "\0\0\0\0", 4);
+    putVarint(frame, (isKey ? FRAME_KEY : 0) | (sameIds ? FRAME_SAME_IDS : 0));
+    putVarint(frame, isKey ? time : time - history->lastTime);
+    putVarint(frame, history->dictCount - history->dictWritten);
+    for(i = history->dictWritten; i < history->dictCount; i++) {
+        size_t len = strlen(history->dict[i]);
+        putVarint(frame, len);
+        putBytes(frame, history->dict[i], len);
+    }
+    putVarint(frame, count);
+    if(!sameIds) {
+        for(i = 0, lastId = 0; i < count; i++) {
+            putVarint(frame, cur[i].id - lastId);
+            lastId = cur[i].id;
+        }
+    }
+
+    /* Change masks, skipping runs of windows that did not change */
+    for(i = 0, run = 0; i < count; i++) {
+        for(mask = 0, f = 0; f < NUM_FIELDS; f++) {
+            diff = (int64_t)cur[i].fields[f] -
+                (prevIndex[i] >= 0 ? prev[prevIndex[i]].fields[f] : 0);
+            if(diff) mask |= 1 << f;
+        }
+        if(mask) {
+            putVarint(frame, run);
+            putVarint(frame, mask);
+            run = 0;
+        } else {
+            run++;
+        }
+    }
+    if(run) putVarint(frame, run);
+
+    /* One column per field, holding differences for windows that changed */
+    for(f = 0; f < NUM_FIELDS; f++) {
+        for(i = 0; i < count; i++) {
+            diff = (int64_t)cur[i].fields[f] -
+                (prevIndex[i] >= 0 ? prev[prevIndex[i]].fields[f] : 0);
+            if(diff) putVarint(frame, zigzag(diff));
+        }
+    }
+
+    /* Write frame in one go, length first */
+    payloadLen = frame->len - 4;
+    for(i = 0; i < 4; i++) frame->bytes[i] = (payloadLen >> (8 * i)) & 0xFF;
+    if(write(history->fd, frame->bytes, frame->len) != (ssize_t)frame->len) {
+        history->framesSinceKey = -1;
+        return -1;
+    }
+    if(time > history->maxTime) history->maxTime = time;
+    if(isKey) {
+        appendIndexEntry(
+            history, time, lseek(history->fd, 0, SEEK_CUR) - frame->len
+        );
+    }
+
+    history->dictWritten = history->dictCount;
+    history->framesSinceKey = isKey ? 0 : history->framesSinceKey + 1;
+    history->lastTime = time;
+    history->lastCount = count;
+    swap = history->last;
+    history->last = history->next;
+    history->next = swap;
+    return 0;
+}
+
+/* Apply one frame to the decoded sample, return -1 if it is malformed */
+static int decodeFrame(
+    WinHistory *history,
+    const unsigned char *p,
+    const unsigned char *end
+) {
+    HistoryWindow *cur, *prev, *swap;
+    uint64_t flags, value, numStrings, len, count, run;
+    uint32_t lastId;
+    int *masks;
+    int i, j, f;
+
+    if(getVarint(&p, end, &flags) == -1) return -1;
+    if(getVarint(&p, end, &value) == -1) return -1;
+    if(flags & FRAME_KEY) {
+        history->dictCount = 0;
+        history->strings.len = 0;
+        history->lastCount = 0;
+    }
+
+    /* Add new strings to the dictionary, NUL terminated */
+    if(getVarint(&p, end, &numStrings) == -1) return -1;
+    if(numStrings > (uint64_t)(end - p)) return -1;
+    for(; numStrings > 0; numStrings--) {
+        if(getVarint(&p, end, &len) == -1) return -1;
+        if(len > (uint64_t)(end - p)) return -1;
+        if(history->dictCount == history->dictCapacity) {
+            history->dictCapacity =
+                history->dictCapacity ? history->dictCapacity * 2 : 256;
+            history->dictOffsets = (size_t *)realloc(
+                history->dictOffsets, history->dictCapacity * sizeof(size_t)
+            );
+        }
+        history->dictOffsets[history->dictCount++] = history->strings.len;
+        putBytes(&history->strings, p, len);
+        putBytes(&history->strings, "", 1);
+        p += len;
+    }
+
+    /* Window IDs, each starting out as it was in the previous sample */
+    if(getVarint(&p, end, &count) == -1) return -1;
+    if(count > (uint64_t)(end - p) * 8 + history->lastCount) return -1;
+    reserveWindows(history, count);
+    cur = history->next;
+    prev = history->last;
+    if(flags & FRAME_SAME_IDS) {
+        if(count != (uint64_t)history->lastCount) return -1;
+        memcpy(cur, prev, count * sizeof(HistoryWindow));
+    } else {
+        for(i = 0, j = 0, lastId = 0; i < (int)count; i++) {
+            if(getVarint(&p, end, &value) == -1) return -1;
+            cur[i].id = lastId += (uint32_t)value;
+            while(j < history->lastCount && prev[j].id < cur[i].id) j++;
+            if(j < history->lastCount && prev[j].id == cur[i].id) {
+                memcpy(cur[i].fields, prev[j].fields, sizeof(cur[i].fields));
+            } else {
+                memset(cur[i].fields, 0, sizeof(cur[i].fields));
+            }
+        }
+    }
+
+    /* Change masks, then the columns of differences */
+    masks = history->scratch;
+    memset(masks, 0, count * sizeof(int));
+    for(i = 0; i < (int)count; i++) {
+        if(getVarint(&p, end, &run) == -1) return -1;
+        if(run > count - i) return -1;
+        i += run;
+        if(i == (int)count) break;
+        if(getVarint(&p, end, &value) == -1) return -1;
+        masks[i] = (int)value;
+    }
+    for(f = 0; f < NUM_FIELDS; f++) {
+        for(i = 0; i < (int)count; i++) {
+            if(!(masks[i] & (1 << f))) continue;
+            if(getVarint(&p, end, &value) == -1) return -1;
+            cur[i].fields[f] += (int32_t)unzigzag(value);
+        }
+    }
+
+    history->lastCount = count;
+    swap = history->last;
+    history->last = history->next;
+    history->next = swap;
+    return 0;
+}
+
+/* Offset in strings of dictionary string at index, NO_STRING if none */
+static size_t dictString(WinHistory *history, int32_t index) {
+    if(index < 0 || index >= history->dictCount) return NO_STRING;
+    return history->dictOffsets[index];
+}
+
+/* Reconstruct last sample at or before time, see winhistory.h */
+int WinHistoryQuery(
+    WinHistory *history,
+    int64_t time,
+    WindowInfo **windows,
+    int64_t *sampleTime
+) {
+    const unsigned char *payload, *end;
+    uint64_t flags;
+    int64_t frameTime;
+    size_t pos, next, keyPos, lastPos, appName, windowName;
+    WindowInfo *info;
+    HistoryWindow *window;
+    int i, found;
+
+    *windows = NULL;
+    *sampleTime = -1;
+    if(!history || history->writable || mapLog(history) == -1) return -1;
+
+    /* Hop from frame to frame by length, reading only flags and times, to
+     * find the last keyframe and last frame at or before time; the index
+     * says which keyframe to start from, so this reads at most one
+     * keyframe interval of frames unless the index is missing or stale
+     */
+    found = 0;
+    frameTime = 0;
+    keyPos = lastPos = 0;
+    for(pos = findKeyframe(history, time); ; pos = next) {
+        next = readFrameHeader(
+            history, pos, &payload, &end, &flags, &frameTime
+        );
+        if(!next || frameTime > time) break;
+        if(flags & FRAME_KEY) keyPos = pos;
+        if(keyPos) {
+            lastPos = pos;
+            *sampleTime = frameTime;
+            found = 1;
+        }
+    }
+    if(!found) return 0;
+
+    /* Decode forward from that keyframe */
+    for(pos = keyPos; pos <= lastPos; pos = next) {
+        next = readFrameHeader(
+            history, pos, &payload, &end, &flags, &frameTime
+        );
+        if(decodeFrame(history, payload, end) == -1) {
+            *sampleTime = -1;
+            return -1;
+        }
+    }
+
+    /* Put windows back in front to back order, with names and titles */
+    memcpy(
+        history->next, history->last,
+        history->lastCount * sizeof(HistoryWindow)
+    );
+    qsort(
+        history->next, history->lastCount, sizeof(HistoryWindow),
+        compareByOrder
+    );
+    *windows = (WindowInfo *)malloc(
+        (history->lastCount + 1) * sizeof(WindowInfo)
+    );
+    history->titles.len = 0;
+    for(i = 0; i < history->lastCount; i++) {
+        window = &history->next[i];
+        info = &(*windows)[i];
+        info->id = window->id;
+        info->pid = window->fields[FIELD_PID];
+        info->layer = window->fields[FIELD_LAYER];
+        info->bounds = CGRectMake(
+            window->fields[FIELD_X], window->fields[FIELD_Y],
+            window->fields[FIELD_WIDTH], window->fields[FIELD_HEIGHT]
+        );
+
+        /* Like windowTitle(), kept as offsets until titles stops growing */
+        appName = dictString(history, window->fields[FIELD_APP_NAME]);
+        windowName = dictString(history, window->fields[FIELD_WINDOW_NAME]);
+        info->title = (const char *)history->titles.len;
+        if(appName != NO_STRING && history->strings.bytes[appName]) {
+            putBytes(
+                &history->titles, history->strings.bytes + appName,
+                strlen((char *)history->strings.bytes + appName)
+            );
+            if(windowName != NO_STRING &&
+               history->strings.bytes[windowName])
+            {
+                putBytes(&history->titles, " - ", 3);
+                putBytes(
+                    &history->titles, history->strings.bytes + windowName,
+                    strlen((char *)history->strings.bytes + windowName)
+                );
+            }
+        }
+        putBytes(&history->titles, "", 1);
+        info->appName = appName == NO_STRING ?
+            "" : (char *)history->strings.bytes + appName;
+        info->windowName = windowName == NO_STRING ?
+            "" : (char *)history->strings.bytes + windowName;
+    }
+    for(i = 0; i < history->lastCount; i++) {
+        (*windows)[i].title =
+            (char *)history->titles.bytes + (size_t)(*windows)[i].title;
+    }
+
+    return history->lastCount;
+}
+
+
+/* ======================================================================== */
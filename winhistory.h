@@ -0,0 +1,94 @@
+/* ========================================================================
+ * winhistory.h - compact log of where windows were over time
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINHISTORY_H
+#define WINHISTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "winsnapshot.h"
+
+#define WINHISTORY_MAGIC 0x686c776d  /* "mwlh" */
+#define WINHISTORY_VERSION 1
+
+/* A keyframe, which does not depend on earlier frames, is written every
+ * this many samples, so a query never decodes more than this many frames
+ */
+#define WINHISTORY_KEYFRAME_INTERVAL 300
+
+/* Opaque handle to a history log, open either for recording or queries */
+typedef struct WinHistory WinHistory;
+
+/* Open log at path for appending samples (creating it if needed), or
+ * map it read-only for queries; return NULL on error
+ */
+WinHistory *WinHistoryOpen(const char *path, int writable);
+void WinHistoryClose(WinHistory *history);
+
+/* Append a sample of count windows in front to back order, taken at time
+ * (milliseconds since the epoch); return 0 on success, -1 on error
+ */
+int WinHistoryAppend(
+    WinHistory *history,
+    int64_t time,
+    const WindowInfo *windows,
+    int count
+);
+
+/* Reconstruct the last sample taken at or before time. On return windows
+ * holds a newly allocated array in front to back order, which the caller
+ * must free(); its strings belong to history and stay valid until the
+ * next query. Set sampleTime to when the sample was taken (-1 if none);
+ * return number of windows, or -1 on error.
+ */
+int WinHistoryQuery(
+    WinHistory *history,
+    int64_t time,
+    WindowInfo **windows,
+    int64_t *sampleTime
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINHISTORY_H */
+
+
+/* ======================================================================== */
@@ -0,0 +1,314 @@
+/* ========================================================================
+ * winjournal.c - undo/redo journal of window moves
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "winjournal.h"
+
+/* On disk layout: a fixed-size ring of entries. head counts every entry
+ * ever appended, cursor is how far back undo has gone (cursor <= head),
+ * and the oldest entry still in the ring is at head - WINJOURNAL_ENTRIES.
+ * Consecutive entries with the same batch are undone and redone as one.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t lastBatch;       /* most recent batch ID handed out */
+    uint64_t head;
+    uint64_t cursor;
+    WinJournalEntry entries[WINJOURNAL_ENTRIES];
+} WinJournalFile;
+
+struct WinJournal {
+    int fd;                   /* kept open for flock() */
+    WinJournalFile *file;
+};
+
+/* Open (creating if needed) journal at path, or at $MOVEWIN_JOURNAL or
+ * ~/.movewin_journal if path is NULL; return NULL on error
+ */
+WinJournal *WinJournalOpen(const char *path) {
+    char defaultPath[1024];
+    const char *home;
+    struct stat st;
+    WinJournal *journal;
+    void *addr;
+    int fd;
+
+    if(!path) path = getenv(WINJOURNAL_ENV);
+    if(!path || !*path) {
+        home = getenv("HOME");
+        if(!home) return NULL;
+        snprintf(
+            defaultPath, sizeof(defaultPath), "%s/%s",
+            home, WINJOURNAL_DEFAULT_FILE
+        );
+        path = defaultPath;
+    }
+
+    fd = open(path, O_RDWR|O_CREAT, 0600);
+    if(fd == -1) return NULL;
+    if(fstat(fd, &st) == -1 ||
+       (st.st_size != sizeof(WinJournalFile) &&
+        ftruncate(fd, sizeof(WinJournalFile)) == -1))
+    {
+        close(fd);
+        return NULL;
+    }
+    addr = mmap(
+        NULL, sizeof(WinJournalFile), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0
+    );
+    if(addr == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    journal = (WinJournal *)malloc(sizeof(WinJournal));
+    journal->fd = fd;
+    journal->file = (WinJournalFile *)addr;
+
+    /* Start over if the file is new, from an incompatible version, or has
+     * a cursor that is past head or has fallen out of the ring
+     */
+    flock(fd, LOCK_EX);
+    if(journal->file->magic != WINJOURNAL_MAGIC ||
+       journal->file->version != WINJOURNAL_VERSION ||
+       journal->file->capacity != WINJOURNAL_ENTRIES ||
+       journal->file->cursor > journal->file->head ||
+       journal->file->head - journal->file->cursor > WINJOURNAL_ENTRIES)
+    {
+        memset(journal->file, 0, offsetof(WinJournalFile, entries));
+        journal->file->version = WINJOURNAL_VERSION;
+        journal->file->capacity = WINJOURNAL_ENTRIES;
+        journal->file->magic = WINJOURNAL_MAGIC;
+    }
+    flock(fd, LOCK_UN);
+
+    return journal;
+}
+
+/* Unmap and close journal */
+void WinJournalClose(WinJournal *journal) {
+    if(!journal) return;
+    munmap((void *)journal->file, sizeof(WinJournalFile));
+    close(journal->fd);
+    free(journal);
+}
+
+/* Copy a string value from a CFDictionary into a fixed-size buffer */
+static void copyCString(
+    CFDictionaryRef dict,
+    const void *key,
+    char *buf,
+    size_t size
+) {
+    const void *value = CFDictionaryGetValue(dict, key);
+    if(!value || !CFStringGetCString(value, buf, size, kCFStringEncodingUTF8))
+    {
+        *buf = '\0';
+    }
+}
+
+/* Return a new batch ID, to group the moves that follow */
+uint32_t WinJournalBeginBatch(WinJournal *journal) {
+    uint32_t batch;
+
+    if(!journal) return 0;
+    flock(journal->fd, LOCK_EX);
+    batch = ++journal->file->lastBatch;
+    if(batch == 0) batch = ++journal->file->lastBatch;
+    flock(journal->fd, LOCK_UN);
+
+    return batch;
+}
+
+/* Record a move as part of batch; this discards anything that could have
+ * been redone
+ */
+void WinJournalAppend(
+    WinJournal *journal,
+    uint32_t batch,
+    CFDictionaryRef window,
+    CGPoint oldPosition, CGSize oldSize,
+    CGPoint newPosition, CGSize newSize
+) {
+    WinJournalFile *file;
+    WinJournalEntry *entry;
+    struct timeval tv;
+
+    if(!journal) return;
+    file = journal->file;
+    gettimeofday(&tv, NULL);
+
+    flock(journal->fd, LOCK_EX);
+    file->head = file->cursor;
+    entry = &file->entries[file->head % WINJOURNAL_ENTRIES];
+    entry->windowId = CFDictionaryGetInt(window, kCGWindowNumber);
+    entry->pid = CFDictionaryGetInt(window, kCGWindowOwnerPID);
+    entry->batch = batch;
+    entry->timestamp = tv.tv_sec + tv.tv_usec / 1e6;
+    entry->oldX = oldPosition.x;
+    entry->oldY = oldPosition.y;
+    entry->oldWidth = oldSize.width;
+    entry->oldHeight = oldSize.height;
+    entry->newX = newPosition.x;
+    entry->newY = newPosition.y;
+    entry->newWidth = newSize.width;
+    entry->newHeight = newSize.height;
+    copyCString(
+        window, kCGWindowOwnerName, entry->appName, sizeof(entry->appName)
+    );
+    copyCString(window, kCGWindowName, entry->title, sizeof(entry->title));
+    file->cursor = ++file->head;
+    flock(journal->fd, LOCK_UN);
+}
+
+/* Set frame for window in targets, adding it if not already there */
+static void setTarget(
+    WinJournalTarget *targets, int *numTargets,
+    CGWindowID windowId, int x, int y, int width, int height
+) {
+    int i;
+
+    for(i = 0; i < *numTargets; i++) {
+        if(targets[i].windowId == windowId) break;
+    }
+    if(i == *numTargets) (*numTargets)++;
+    targets[i].windowId = windowId;
+    targets[i].position = CGPointMake(x, y);
+    targets[i].size = CGSizeMake(width, height);
+}
+
+/* Return batch of entry at index, counting every entry ever appended */
+static uint32_t batchAt(const WinJournalFile *file, uint64_t index) {
+    return file->entries[index % WINJOURNAL_ENTRIES].batch;
+}
+
+/* Step back (undo) over up to n batches, newest first, so each window
+ * ends up with the frame it had before the oldest move undone
+ */
+int WinJournalUndo(
+    WinJournal *journal, int n,
+    WinJournalTarget **targets, int *numTargets
+) {
+    WinJournalFile *file;
+    WinJournalEntry *entry;
+    uint64_t oldest;
+    uint32_t batch;
+    int stepped;
+
+    *targets = NULL;
+    *numTargets = 0;
+    if(!journal || n <= 0) return 0;
+    if(n > WINJOURNAL_ENTRIES) n = WINJOURNAL_ENTRIES;
+    file = journal->file;
+
+    /* There can be no more targets than entries left to undo */
+    flock(journal->fd, LOCK_EX);
+    oldest = file->head > WINJOURNAL_ENTRIES ?
+        file->head - WINJOURNAL_ENTRIES : 0;
+    *targets = (WinJournalTarget *)malloc(
+        (file->cursor - oldest + 1) * sizeof(WinJournalTarget)
+    );
+    if(!*targets) {
+        flock(journal->fd, LOCK_UN);
+        return 0;
+    }
+    for(stepped = 0; stepped < n && file->cursor > oldest; stepped++) {
+        batch = batchAt(file, file->cursor - 1);
+        do {
+            entry = &file->entries[--file->cursor % WINJOURNAL_ENTRIES];
+            setTarget(
+                *targets, numTargets, entry->windowId,
+                entry->oldX, entry->oldY, entry->oldWidth, entry->oldHeight
+            );
+        } while(file->cursor > oldest &&
+                batchAt(file, file->cursor - 1) == batch);
+    }
+    flock(journal->fd, LOCK_UN);
+
+    return stepped;
+}
+
+/* Step forward (redo) over up to n undone batches, oldest first, so each
+ * window ends up with the frame from the newest move redone
+ */
+int WinJournalRedo(
+    WinJournal *journal, int n,
+    WinJournalTarget **targets, int *numTargets
+) {
+    WinJournalFile *file;
+    WinJournalEntry *entry;
+    uint32_t batch;
+    int stepped;
+
+    *targets = NULL;
+    *numTargets = 0;
+    if(!journal || n <= 0) return 0;
+    if(n > WINJOURNAL_ENTRIES) n = WINJOURNAL_ENTRIES;
+    file = journal->file;
+
+    /* There can be no more targets than entries left to redo */
+    flock(journal->fd, LOCK_EX);
+    *targets = (WinJournalTarget *)malloc(
+        (file->head - file->cursor + 1) * sizeof(WinJournalTarget)
+    );
+    if(!*targets) {
+        flock(journal->fd, LOCK_UN);
+        return 0;
+    }
+    for(stepped = 0; stepped < n && file->cursor < file->head; stepped++) {
+        batch = batchAt(file, file->cursor);
+        do {
+            entry = &file->entries[file->cursor++ % WINJOURNAL_ENTRIES];
+            setTarget(
+                *targets, numTargets, entry->windowId,
+                entry->newX, entry->newY, entry->newWidth, entry->newHeight
+            );
+        } while(file->cursor < file->head &&
+                batchAt(file, file->cursor) == batch);
+    }
+    flock(journal->fd, LOCK_UN);
+
+    return stepped;
+}
+
+/* ======================================================================== */
@@ -0,0 +1,118 @@
+/* ========================================================================
+ * winjournal.h - undo/redo journal of window moves
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINJOURNAL_H
+#define WINJOURNAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "winutils.h"
+
+#define WINJOURNAL_ENV "MOVEWIN_JOURNAL"
+#define WINJOURNAL_DEFAULT_FILE ".movewin_journal"
+#define WINJOURNAL_MAGIC 0x6c6a776d  /* "mwjl" */
+#define WINJOURNAL_VERSION 2
+#define WINJOURNAL_ENTRIES 4096
+
+/* One recorded move of one window */
+typedef struct {
+    uint32_t windowId;
+    int32_t pid;
+    uint32_t batch;            /* shared by every move of one movewin run */
+    double timestamp;          /* seconds since the epoch */
+    int32_t oldX, oldY, oldWidth, oldHeight;
+    int32_t newX, newY, newWidth, newHeight;
+    char appName[64];          /* truncated, for display only */
+    char title[128];
+} WinJournalEntry;
+
+/* Frame a window should be given back when replaying the journal */
+typedef struct {
+    CGWindowID windowId;
+    CGPoint position;
+    CGSize size;
+} WinJournalTarget;
+
+/* Opaque handle to a memory mapped journal file */
+typedef struct WinJournal WinJournal;
+
+/* Open (creating if needed) journal at path, or at $MOVEWIN_JOURNAL or
+ * ~/.movewin_journal if path is NULL; return NULL on error
+ */
+WinJournal *WinJournalOpen(const char *path);
+void WinJournalClose(WinJournal *journal);
+
+/* Return a new batch ID, to group the moves that follow so they are undone
+ * and redone together (0 if journal is NULL)
+ */
+uint32_t WinJournalBeginBatch(WinJournal *journal);
+
+/* Record a move as part of batch; this discards anything that could have
+ * been redone
+ */
+void WinJournalAppend(
+    WinJournal *journal,
+    uint32_t batch,
+    CFDictionaryRef window,
+    CGPoint oldPosition, CGSize oldSize,
+    CGPoint newPosition, CGSize newSize
+);
+
+/* Step back (undo) or forward (redo) over up to n batches of moves. On
+ * return, targets holds a newly allocated array of one frame per affected
+ * window, which the caller must free(); return number of batches stepped
+ * over (0, with targets NULL, if out of memory).
+ */
+int WinJournalUndo(
+    WinJournal *journal, int n,
+    WinJournalTarget **targets, int *numTargets
+);
+int WinJournalRedo(
+    WinJournal *journal, int n,
+    WinJournalTarget **targets, int *numTargets
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINJOURNAL_H */
+
+
+/* ======================================================================== */
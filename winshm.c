@@ -0,0 +1,333 @@
+/* ========================================================================
+ * winshm.c - publish the window table in shared memory for local readers
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "winshm.h"
+#include "winutf8.h"
+
+struct WinShmPublisher {
+    WinShmRegion *region;
+    int lockFd;               /* flock()ed for as long as we publish */
+};
+
+/* Fill in name of the calling user's own shared memory object for name */
+static void userObjectName(char *objectName, size_t size, const char *name) {
+    snprintf(objectName, size, "%s.%u", name, (unsigned int)getuid());
+}
+
+/* Map named shared memory object of given size, creating it if writable */
+void *WinShmMap(const char *name, size_t size, int writable) {
+    char objectName[256];
+    struct stat st;
+    void *addr;
+    int fd;
+
+    userObjectName(objectName, sizeof(objectName), name);
+    fd = writable ? shm_open(objectName, O_RDWR|O_CREAT, 0600)
+                  : shm_open(objectName, O_RDONLY, 0);
+    if(fd == -1) return NULL;
+
+    /* An object another user made under our name could hand us their
+     * data, or take ours, so only ever use our own
+     */
+    if(fstat(fd, &st) == -1 || st.st_uid != geteuid()) {
+        close(fd);
+        return NULL;
+    }
+
+    /* OS X only allows sizing a shared memory object once */
+    if(writable && st.st_size != (off_t)size && ftruncate(fd, size) == -1) {
+        close(fd);
+        return NULL;
+    }
+
+    addr = mmap(
+        NULL, size, writable ? (PROT_READ|PROT_WRITE) : PROT_READ,
+        MAP_SHARED, fd, 0
+    );
+    close(fd);
+
+    return addr == MAP_FAILED ? NULL : addr;
+}
+
+/* Remove the calling user's shared memory object for name */
+int WinShmUnlink(const char *name) {
+    char objectName[256];
+
+    userObjectName(objectName, sizeof(objectName), name);
+    return shm_unlink(objectName);
+}
+
+/* Open window table region for publishing or reading (NULL on error) */
+WinShmRegion *WinShmOpen(const char *name, int writable) {
+    WinShmRegion *region;
+
+    region = (WinShmRegion *)WinShmMap(name, sizeof(WinShmRegion), writable);
+    if(!region) return NULL;
+
+    if(writable) {
+        if(region->magic != WINSHM_MAGIC) {
+            atomic_store(&region->sequence, 0);
+            region->version = WINSHM_VERSION;
+            region->magic = WINSHM_MAGIC;
+        }
+    } else if(region->magic != WINSHM_MAGIC ||
+              region->version != WINSHM_VERSION)
+    {
+        WinShmClose(region);
+        return NULL;
+    }
+
+    return region;
+}
+
+/* Unmap window table region */
+void WinShmClose(WinShmRegion *region) {
+    if(region) munmap((void *)region, sizeof(WinShmRegion));
+}
+
+/* Fill in path of per-user lock file for publishing to region name */
+static void publisherLockPath(char *path, size_t size, const char *name) {
+    const char *tmpdir = getenv("TMPDIR");
+    char *s;
+    int len;
+
+    if(!tmpdir || !*tmpdir) tmpdir = "/tmp";
+    len = snprintf(
+        path, size, "%s/movewin-shm-%u-", tmpdir, (unsigned int)getuid()
+    );
+    snprintf(path + len, size - len, "%s", name);
+    for(s = path + len; *s; s++) if(*s == '/') *s = '_';
+}
+
+/* Open region for publishing, holding an exclusive lock on it until closed.
+ * The lock is on a file rather than the region, which OS X cannot flock(),
+ * and goes away with the process however it exits.
+ */
+WinShmPublisher *WinShmPublisherOpen(const char *name) {
+    WinShmPublisher *publisher;
+    WinShmRegion *region;
+    unsigned int sequence;
+    char path[1024];
+    int fd;
+
+    publisherLockPath(path, sizeof(path), name);
+    fd = open(path, O_RDWR|O_CREAT|O_NOFOLLOW, 0600);
+    if(fd == -1) return NULL;
+    if(flock(fd, LOCK_EX|LOCK_NB) == -1) {
+        close(fd);
+        return NULL;
+    }
+    region = WinShmOpen(name, 1);
+    if(!region) {
+        close(fd);
+        return NULL;
+    }
+
+    /* A publisher killed mid-update left the sequence odd; empty the table
+     * it was writing, then make the sequence even so readers can proceed
+     */
+    sequence = atomic_load_explicit(&region->sequence, memory_order_relaxed);
+    if(sequence & 1) {
+        region->table.count = region->table.stringsLen = 0;
+        atomic_store_explicit(
+            &region->sequence, sequence + 1, memory_order_release
+        );
+    }
+
+    publisher = (WinShmPublisher *)malloc(sizeof(WinShmPublisher));
+    publisher->region = region;
+    publisher->lockFd = fd;
+
+    return publisher;
+}
+
+/* Unmap region and give up the lock on publishing to it */
+void WinShmPublisherClose(WinShmPublisher *publisher) {
+    if(!publisher) return;
+    WinShmClose(publisher->region);
+    close(publisher->lockFd);
+    free(publisher);
+}
+
+/* Append string to table string pool, return its offset (-1 if full) */
+static int64_t appendString(WinShmTable *table, const char *s) {
+    size_t len = strlen(s) + 1;
+    uint32_t offset = table->stringsLen;
+
+    if(offset + len > WINSHM_STRINGS_SIZE) return -1;
+    memcpy(table->strings + offset, s, len);
+    table->stringsLen += len;
+
+    return offset;
+}
+
+/* Callback for EnumerateWindowListUTF8() adds each window to the table */
+static void AddWindow(
+    CFDictionaryRef window,
+    char *appName,
+    char *windowName,
+    void *tablePtr
+) {
+    WinShmTable *table = (WinShmTable *)tablePtr;
+    char *title;
+    int64_t appOffset, windowOffset, titleOffset;
+    uint32_t stringsLen = table->stringsLen;
+    CGPoint position;
+    CGSize size;
+    WinShmRecord *record;
+
+    if(table->count >= WINSHM_MAX_WINDOWS) return;
+
+    title = windowTitle(appName, windowName);
+    appOffset = appendString(table, appName);
+    windowOffset = appendString(table, windowName);
+    titleOffset = appendString(table, title);
+    free(title);
+
+    /* If string pool is full, drop this window's strings and skip it */
+    if(appOffset < 0 || windowOffset < 0 || titleOffset < 0) {
+        table->stringsLen = stringsLen;
+        return;
+    }
+
+    position = CGWindowGetPosition(window);
+    size = CGWindowGetSize(window);
+    record = &table->records[table->count++];
+    record->id = CFDictionaryGetInt(window, kCGWindowNumber);
+    record->pid = CFDictionaryGetInt(window, kCGWindowOwnerPID);
+    record->layer = CFDictionaryGetInt(window, kCGWindowLayer);
+    record->x = position.x;
+    record->y = position.y;
+    record->width = size.width;
+    record->height = size.height;
+    record->appName = appOffset;
+    record->windowName = windowOffset;
+    record->title = titleOffset;
+}
+
+/* Enumerate windows matching pattern (NULL for all) and publish them.
+ * The table is built privately first, so that the region is only in an
+ * inconsistent (odd sequence) state for the duration of two memcpy()s.
+ */
+int WinShmPublish(WinShmPublisher *publisher, char *pattern) {
+    WinShmRegion *region = publisher->region;
+    CF_SCOPED CFArrayRef windowList = NULL;
+    WinShmTable *table;
+    unsigned int sequence;
+    int count;
+
+    table = (WinShmTable *)malloc(sizeof(WinShmTable));
+    table->count = table->stringsLen = 0;
+    windowList = CopyWindowList();
+    EnumerateWindowListUTF8(windowList, pattern, AddWindow, (void *)table);
+    count = table->count;
+
+    /* The lock keeps sequence even between publishes; |1 keeps it odd
+     * during one even if something else wrote to the region
+     */
+    sequence = atomic_load_explicit(&region->sequence, memory_order_relaxed);
+    sequence |= 1;
+    atomic_store_explicit(&region->sequence, sequence, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    region->table.generation++;
+    region->table.count = table->count;
+    region->table.stringsLen = table->stringsLen;
+    memcpy(
+        region->table.records, table->records,
+        table->count * sizeof(WinShmRecord)
+    );
+    memcpy(region->table.strings, table->strings, table->stringsLen);
+
+    atomic_store_explicit(
+        &region->sequence, sequence + 1, memory_order_release
+    );
+    free(table);
+
+    return count;
+}
+
+/* Copy a consistent snapshot of the table, return 0, or -1 if not valid or
+ * still mid-update after WINSHM_READ_RETRIES tries
+ */
+int WinShmRead(const WinShmRegion *region, WinShmTable *table) {
+    WinShmRegion *r = (WinShmRegion *)region;
+    unsigned int before, after;
+    uint32_t count, stringsLen;
+    int tries = 0;
+
+    if(r->magic != WINSHM_MAGIC) return -1;
+
+    /* Retry until the sequence is even and unchanged across the copy,
+     * giving up in case the publisher died mid-update
+     */
+    do {
+        if(tries++ == WINSHM_READ_RETRIES) return -1;
+        if(tries > 1) sched_yield();
+        before = atomic_load_explicit(&r->sequence, memory_order_acquire);
+        if(before & 1) continue;
+
+        /* Counts may be torn mid-update, so clamp before copying */
+        count = r->table.count;
+        stringsLen = r->table.stringsLen;
+        if(count > WINSHM_MAX_WINDOWS) count = WINSHM_MAX_WINDOWS;
+        if(stringsLen > WINSHM_STRINGS_SIZE) stringsLen = WINSHM_STRINGS_SIZE;
+
+        table->generation = r->table.generation;
+        table->count = count;
+        table->stringsLen = stringsLen;
+        memcpy(table->records, r->table.records, count * sizeof(WinShmRecord));
+        memcpy(table->strings, r->table.strings, stringsLen);
+
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&r->sequence, memory_order_relaxed);
+    } while((before & 1) || before != after);
+
+    return 0;
+}
+
+/* Return string at given pool offset of a table */
+const char *WinShmString(const WinShmTable *table, uint32_t offset) {
+    return offset < table->stringsLen ? table->strings + offset : "";
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,130 @@
+/* ========================================================================
+ * winshm.h - publish the window table in shared memory for local readers
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINSHM_H
+#define WINSHM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "winutils.h"
+
+#define WINSHM_DEFAULT_NAME "/movewin.windows"
+#define WINSHM_MAGIC 0x6e69776d  /* "mwin" */
+#define WINSHM_VERSION 1
+#define WINSHM_MAX_WINDOWS 1024
+#define WINSHM_STRINGS_SIZE (256 * 1024)
+#define WINSHM_READ_RETRIES 10000
+
+/* One window; string fields are offsets into the table string pool */
+typedef struct {
+    uint32_t id;
+    int32_t pid;
+    int32_t layer;
+    int32_t x, y, width, height;
+    uint32_t appName;
+    uint32_t windowName;
+    uint32_t title;
+} WinShmRecord;
+
+/* Window table as published by a writer and as copied out by a reader */
+typedef struct {
+    uint64_t generation;      /* incremented on every publish */
+    uint32_t count;           /* number of valid records */
+    uint32_t stringsLen;      /* number of valid bytes in strings */
+    WinShmRecord records[WINSHM_MAX_WINDOWS];
+    char strings[WINSHM_STRINGS_SIZE];
+} WinShmTable;
+
+/* Shared memory layout; sequence is odd while the publisher is updating */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    atomic_uint sequence;
+    uint32_t reserved;
+    WinShmTable table;
+} WinShmRegion;
+
+/* Map named shared memory object of given size, creating it if writable.
+ * Each user gets their own object, readable by them alone, so that the
+ * window titles in it are no more visible than through the window server;
+ * one that exists under the name but belongs to someone else is refused.
+ */
+void *WinShmMap(const char *name, size_t size, int writable);
+
+/* Remove the calling user's shared memory object for name */
+int WinShmUnlink(const char *name);
+
+/* Open window table region for reading (NULL on error); writable opens
+ * are for WinShmPublisherOpen(), as only the publisher may update it
+ */
+WinShmRegion *WinShmOpen(const char *name, int writable);
+void WinShmClose(WinShmRegion *region);
+
+/* Opaque handle of the one process allowed to publish to a region */
+typedef struct WinShmPublisher WinShmPublisher;
+
+/* Open region for publishing, holding an exclusive lock on it until closed
+ * (NULL on error, or if another process is publishing to it). A table a
+ * killed publisher left mid-update is emptied, so readers can go on.
+ */
+WinShmPublisher *WinShmPublisherOpen(const char *name);
+void WinShmPublisherClose(WinShmPublisher *publisher);
+
+/* Enumerate windows matching pattern (NULL for all) and publish them,
+ * return number of windows published
+ */
+int WinShmPublish(WinShmPublisher *publisher, char *pattern);
+
+/* Copy a consistent snapshot of the table, return 0, or -1 if not valid or
+ * still mid-update after WINSHM_READ_RETRIES tries
+ */
+int WinShmRead(const WinShmRegion *region, WinShmTable *table);
+
+/* Return string at given pool offset of a table */
+const char *WinShmString(const WinShmTable *table, uint32_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINSHM_H */
+
+
+/* ======================================================================== */
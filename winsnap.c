@@ -0,0 +1,327 @@
+/* ========================================================================
+ * winsnap.c - snap window edges to neighbouring windows and displays
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include "winsnap.h"
+
+/* Most displays looked up for their edges */
+#define MAX_DISPLAYS 32
+
+struct WinSnapIndex {
+    WinSnapEdge *vertical;    /* left and right edges, sorted by x */
+    WinSnapEdge *horizontal;  /* top and bottom edges, sorted by y */
+    int count;                /* edges in each array */
+    int capacity;             /* edges each array has room for */
+};
+
+/* Accumulates window frames during enumeration */
+typedef struct {
+    CGRect *frames;
+    CGWindowID *ids;
+    int count, capacity;
+} FrameList;
+
+/* Sort edges by position */
+static int compareEdges(const void *a, const void *b) {
+    CGFloat atA = ((const WinSnapEdge *)a)->at;
+    CGFloat atB = ((const WinSnapEdge *)b)->at;
+    return (atA > atB) - (atA < atB);
+}
+
+/* Set the two vertical and two horizontal edges of window id's frame */
+static void setEdges(
+    CGRect frame,
+    CGWindowID id,
+    WinSnapEdge *vertical,
+    WinSnapEdge *horizontal
+) {
+    frame = CGRectStandardize(frame);
+
+    vertical[0].at = CGRectGetMinX(frame);
+    vertical[1].at = CGRectGetMaxX(frame);
+    vertical[0].from = vertical[1].from = CGRectGetMinY(frame);
+    vertical[0].to = vertical[1].to = CGRectGetMaxY(frame);
+    vertical[0].id = vertical[1].id = id;
+
+    horizontal[0].at = CGRectGetMinY(frame);
+    horizontal[1].at = CGRectGetMaxY(frame);
+    horizontal[0].from = horizontal[1].from = CGRectGetMinX(frame);
+    horizontal[0].to = horizontal[1].to = CGRectGetMaxX(frame);
+    horizontal[0].id = horizontal[1].id = id;
+}
+
+/* Index the edges of count frames, see winsnap.h */
+WinSnapIndex *WinSnapIndexCreate(
+    const CGRect *frames,
+    const CGWindowID *ids,
+    int count
+) {
+    WinSnapIndex *index;
+    int i;
+
+    index = (WinSnapIndex *)malloc(sizeof(WinSnapIndex));
+    index->count = 2 * count;
+    index->capacity = index->count + 2;
+    index->vertical = (WinSnapEdge *)malloc(
+        index->capacity * sizeof(WinSnapEdge)
+    );
+    index->horizontal = (WinSnapEdge *)malloc(
+        index->capacity * sizeof(WinSnapEdge)
+    );
+    for(i = 0; i < count; i++) {
+        setEdges(
+            frames[i], ids ? ids[i] : 0,
+            &index->vertical[2 * i], &index->horizontal[2 * i]
+        );
+    }
+    qsort(index->vertical, index->count, sizeof(WinSnapEdge), compareEdges);
+    qsort(index->horizontal, index->count, sizeof(WinSnapEdge), compareEdges);
+
+    return index;
+}
+
+/* Replace edges of window id among count sorted edges with the two in
+ * add, keeping them sorted; return the new number of edges
+ */
+static int replaceEdges(
+    WinSnapEdge *edges,
+    int count,
+    CGWindowID id,
+    const WinSnapEdge *add
+) {
+    int i, j, lo, hi, mid;
+
+    for(i = j = 0; i < count; i++) {
+        if(edges[i].id != id) edges[j++] = edges[i];
+    }
+    count = j;
+    for(i = 0; i < 2; i++) {
+        lo = 0;
+        hi = count;
+        while(lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            if(edges[mid].at <= add[i].at) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        memmove(&edges[lo + 1], &edges[lo], (count - lo) * sizeof(*edges));
+        edges[lo] = add[i];
+        count++;
+    }
+
+    return count;
+}
+
+/* Move the edges of window id to frame, see winsnap.h */
+void WinSnapIndexUpdate(WinSnapIndex *index, CGWindowID id, CGRect frame) {
+    WinSnapEdge vertical[2], horizontal[2];
+
+    if(!index || !id) return;
+    if(index->count + 2 > index->capacity) {
+        index->capacity = index->capacity * 2 + 2;
+        index->vertical = (WinSnapEdge *)realloc(
+            index->vertical, index->capacity * sizeof(WinSnapEdge)
+        );
+        index->horizontal = (WinSnapEdge *)realloc(
+            index->horizontal, index->capacity * sizeof(WinSnapEdge)
+        );
+    }
+    setEdges(frame, id, vertical, horizontal);
+    replaceEdges(index->vertical, index->count, id, vertical);
+    index->count = replaceEdges(
+        index->horizontal, index->count, id, horizontal
+    );
+}
+
+/* Append frame of window id (0 for a display) to list */
+static void appendFrame(FrameList *list, CGRect frame, CGWindowID id) {
+    if(list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->frames = (CGRect *)realloc(
+            list->frames, list->capacity * sizeof(CGRect)
+        );
+        list->ids = (CGWindowID *)realloc(
+            list->ids, list->capacity * sizeof(CGWindowID)
+        );
+    }
+    list->frames[list->count] = frame;
+    list->ids[list->count] = id;
+    list->count++;
+}
+
+/* Callback for EnumerateWindowList() collects each window's frame */
+static void AddFrame(CFDictionaryRef window, void *listPtr) {
+    CGRect frame;
+
+    frame.origin = CGWindowGetPosition(window);
+    frame.size = CGWindowGetSize(window);
+    appendFrame(
+        (FrameList *)listPtr, frame,
+        CFDictionaryGetInt(window, kCGWindowNumber)
+    );
+}
+
+/* Index the edges of windows in windowList and of displays */
+WinSnapIndex *WinSnapIndexCreateFromWindowList(CFArrayRef windowList) {
+    CGDirectDisplayID displays[MAX_DISPLAYS];
+    uint32_t numDisplays, i;
+    WinSnapIndex *index;
+    FrameList list;
+
+    memset(&list, 0, sizeof(list));
+    EnumerateWindowList(windowList, NULL, AddFrame, (void *)&list);
+
+    /* Display edges belong to no window, so they are never excluded */
+    if(CGGetActiveDisplayList(MAX_DISPLAYS, displays, &numDisplays) !=
+       kCGErrorSuccess)
+    {
+        numDisplays = 0;
+    }
+    for(i = 0; i < numDisplays; i++) {
+        appendFrame(&list, CGDisplayBounds(displays[i]), 0);
+    }
+
+    index = WinSnapIndexCreate(list.frames, list.ids, list.count);
+    free(list.frames);
+    free(list.ids);
+    return index;
+}
+
+void WinSnapIndexDestroy(WinSnapIndex *index) {
+    if(!index) return;
+    free(index->vertical);
+    free(index->horizontal);
+    free(index);
+}
+
+/* Find nearest edge within tolerance, see winsnap.h */
+int WinSnapFindEdge(
+    const WinSnapIndex *index,
+    int vertical,
+    CGFloat at,
+    CGFloat from,
+    CGFloat to,
+    CGWindowID exclude,
+    CGFloat tolerance,
+    CGFloat *edge
+) {
+    const WinSnapEdge *edges;
+    CGFloat distance, best;
+    int lo, hi, mid, i, found;
+
+    if(!index) return 0;
+    edges = vertical ? index->vertical : index->horizontal;
+
+    /* Binary search for the first edge no further than tolerance before */
+    lo = 0;
+    hi = index->count;
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(edges[mid].at < at - tolerance) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* Then take the nearest of the edges in range that qualify */
+    found = 0;
+    best = tolerance;
+    for(i = lo; i < index->count && edges[i].at <= at + tolerance; i++) {
+        if(edges[i].id && edges[i].id == exclude) continue;
+        if(edges[i].from > to + tolerance || edges[i].to < from - tolerance) {
+            continue;
+        }
+        distance = fabs(edges[i].at - at);
+        if(!found || distance < best) {
+            best = distance;
+            *edge = edges[i].at;
+            found = 1;
+        }
+    }
+
+    return found;
+}
+
+/* Return frame of window id snapped to nearby edges, see winsnap.h */
+CGRect WinSnapFrame(
+    const WinSnapIndex *index,
+    CGWindowID id,
+    CGRect frame,
+    CGFloat tolerance,
+    int resize
+) {
+    CGFloat minX, maxX, minY, maxY, low, high;
+    int hasLow, hasHigh;
+
+    frame = CGRectStandardize(frame);
+    minX = CGRectGetMinX(frame);
+    maxX = CGRectGetMaxX(frame);
+    minY = CGRectGetMinY(frame);
+    maxY = CGRectGetMaxY(frame);
+
+    /* Left and right edges */
+    hasLow = WinSnapFindEdge(index, 1, minX, minY, maxY, id, tolerance, &low);
+    hasHigh = WinSnapFindEdge(index, 1, maxX, minY, maxY, id, tolerance, &high);
+    if(resize) {
+        if(hasLow && low < (hasHigh ? high : maxX)) frame.origin.x = low;
+        if(hasHigh && high > frame.origin.x) maxX = high;
+        frame.size.width = maxX - frame.origin.x;
+    } else if(hasLow && (!hasHigh || fabs(low - minX) <= fabs(high - maxX))) {
+        frame.origin.x = low;
+    } else if(hasHigh) {
+        frame.origin.x = high - frame.size.width;
+    }
+
+    /* Top and bottom edges */
+    hasLow = WinSnapFindEdge(index, 0, minY, minX, maxX, id, tolerance, &low);
+    hasHigh = WinSnapFindEdge(index, 0, maxY, minX, maxX, id, tolerance, &high);
+    if(resize) {
+        if(hasLow && low < (hasHigh ? high : maxY)) frame.origin.y = low;
+        if(hasHigh && high > frame.origin.y) maxY = high;
+        frame.size.height = maxY - frame.origin.y;
+    } else if(hasLow && (!hasHigh || fabs(low - minY) <= fabs(high - maxY))) {
+        frame.origin.y = low;
+    } else if(hasHigh) {
+        frame.origin.y = high - frame.size.height;
+    }
+
+    return frame;
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,115 @@
+/* ========================================================================
+ * winsnap.h - snap window edges to neighbouring windows and displays
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINSNAP_H
+#define WINSNAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "winutils.h"
+
+/* Default distance, in points, within which edges snap together */
+#define WINSNAP_DEFAULT_TOLERANCE 16
+
+/* An edge of a window or display: the line x = at (vertical edges) or
+ * y = at (horizontal edges), from from to to along the other axis
+ */
+typedef struct {
+    CGFloat at;
+    CGFloat from, to;
+    CGWindowID id;            /* window the edge belongs to, 0 for displays */
+} WinSnapEdge;
+
+/* Opaque index of edges, sorted by position for O(log n) lookups */
+typedef struct WinSnapIndex WinSnapIndex;
+
+/* Index the edges of count frames, with window IDs (NULL for all 0) */
+WinSnapIndex *WinSnapIndexCreate(
+    const CGRect *frames,
+    const CGWindowID *ids,
+    int count
+);
+
+/* Index the edges of every window EnumerateWindowList() would visit in
+ * windowList, and of every active display
+ */
+WinSnapIndex *WinSnapIndexCreateFromWindowList(CFArrayRef windowList);
+
+/* Move the edges of window id to frame, adding them if the index has
+ * none for id yet; display edges (id 0) cannot be moved
+ */
+void WinSnapIndexUpdate(WinSnapIndex *index, CGWindowID id, CGRect frame);
+
+void WinSnapIndexDestroy(WinSnapIndex *index);
+
+/* Find the edge nearest at, no further than tolerance, that runs
+ * alongside from..to (within tolerance) and does not belong to window
+ * exclude; vertical selects x edges, otherwise y edges. Return true and
+ * set edge to its position if found.
+ */
+int WinSnapFindEdge(
+    const WinSnapIndex *index,
+    int vertical,
+    CGFloat at,
+    CGFloat from,
+    CGFloat to,
+    CGWindowID exclude,
+    CGFloat tolerance,
+    CGFloat *edge
+);
+
+/* Return frame of window id moved so that its nearest left or right edge,
+ * and nearest top or bottom edge, meet edges within tolerance; if resize,
+ * move each of the four edges on its own instead, changing the size
+ */
+CGRect WinSnapFrame(
+    const WinSnapIndex *index,
+    CGWindowID id,
+    CGRect frame,
+    CGFloat tolerance,
+    int resize
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINSNAP_H */
+
+
+/* ======================================================================== */
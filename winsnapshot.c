@@ -0,0 +1,325 @@
+/* ========================================================================
+ * winsnapshot.c - immutable, reference counted snapshots of the window list
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <sched.h>
+#include "winsnapshot.h"
+#include "winutf8.h"
+
+/* Entry in the ID index of a snapshot */
+typedef struct {
+    CGWindowID id;
+    int index;
+} WindowIdIndex;
+
+struct WindowSnapshot {
+    atomic_int refCount;
+    int count;
+    WindowInfo *windows;      /* in enumeration (front to back) order */
+    WindowIdIndex *byId;      /* window ID to index, sorted by window ID */
+    char *strings;            /* every string in windows, NUL separated */
+};
+
+/* Accumulates windows during enumeration, string fields hold pool offsets */
+typedef struct {
+    WindowInfo *windows;
+    int count, capacity;
+    char *strings;
+    size_t stringsLen, stringsCapacity;
+} SnapshotBuilder;
+
+/* Append string to builder string pool, return its offset */
+static size_t appendString(SnapshotBuilder *builder, const char *s) {
+    size_t len = strlen(s) + 1, offset = builder->stringsLen;
+    if(builder->stringsLen + len > builder->stringsCapacity) {
+        while(builder->stringsLen + len > builder->stringsCapacity) {
+            builder->stringsCapacity = builder->stringsCapacity ?
+                builder->stringsCapacity * 2 : 4096;
+        }
+        builder->strings =
+            (char *)realloc(builder->strings, builder->stringsCapacity);
+    }
+    memcpy(builder->strings + offset, s, len);
+    builder->stringsLen += len;
+    return offset;
+}
+
+/* Append one window to builder, copying its strings into the pool */
+static void addWindowInfo(
+    SnapshotBuilder *builder,
+    CGWindowID id,
+    pid_t pid,
+    int layer,
+    CGRect bounds,
+    const char *appName,
+    const char *windowName,
+    const char *title
+) {
+    WindowInfo *info;
+
+    if(builder->count == builder->capacity) {
+        builder->capacity = builder->capacity ? builder->capacity * 2 : 64;
+        builder->windows = (WindowInfo *)realloc(
+            builder->windows, builder->capacity * sizeof(WindowInfo)
+        );
+    }
+    info = &builder->windows[builder->count++];
+    info->id = id;
+    info->pid = pid;
+    info->layer = layer;
+    info->bounds = bounds;
+    info->appName = (const char *)appendString(builder, appName ? appName : "");
+    info->windowName =
+        (const char *)appendString(builder, windowName ? windowName : "");
+    info->title = (const char *)appendString(builder, title);
+}
+
+/* Callback for EnumerateWindowListUTF8() copies each window into the
+ * builder, with the names it already converted
+ */
+static void AddWindow(
+    CFDictionaryRef window,
+    char *appName,
+    char *windowName,
+    void *builderPtr
+) {
+    SnapshotBuilder *builder = (SnapshotBuilder *)builderPtr;
+    char *title = windowTitle(appName, windowName);
+    CGRect bounds;
+
+    bounds.origin = CGWindowGetPosition(window);
+    bounds.size = CGWindowGetSize(window);
+
+    addWindowInfo(
+        builder,
+        CFDictionaryGetInt(window, kCGWindowNumber),
+        CFDictionaryGetInt(window, kCGWindowOwnerPID),
+        CFDictionaryGetInt(window, kCGWindowLayer),
+        bounds, appName, windowName, title
+    );
+
+    free(title);
+}
+
+/* Sort ID index entries by window ID */
+static int compareById(const void *a, const void *b) {
+    CGWindowID idA = ((const WindowIdIndex *)a)->id;
+    CGWindowID idB = ((const WindowIdIndex *)b)->id;
+    return (idA > idB) - (idA < idB);
+}
+
+/* Turn a filled in builder into a snapshot, taking over its memory */
+static WindowSnapshot *finishSnapshot(SnapshotBuilder *builder) {
+    WindowSnapshot *snapshot;
+    int i;
+
+    snapshot = (WindowSnapshot *)malloc(sizeof(WindowSnapshot));
+    atomic_init(&snapshot->refCount, 1);
+    snapshot->count = builder->count;
+    snapshot->windows = builder->windows;
+    snapshot->strings = builder->strings;
+
+    /* Now that the string pool will not move, turn offsets into pointers */
+    for(i = 0; i < snapshot->count; i++) {
+        WindowInfo *info = &snapshot->windows[i];
+        info->appName = snapshot->strings + (size_t)info->appName;
+        info->windowName = snapshot->strings + (size_t)info->windowName;
+        info->title = snapshot->strings + (size_t)info->title;
+    }
+
+    /* Build index for looking up windows by ID */
+    snapshot->byId = (WindowIdIndex *)malloc(
+        (snapshot->count + 1) * sizeof(WindowIdIndex)
+    );
+    for(i = 0; i < snapshot->count; i++) {
+        snapshot->byId[i].id = snapshot->windows[i].id;
+        snapshot->byId[i].index = i;
+    }
+    qsort(snapshot->byId, snapshot->count, sizeof(WindowIdIndex), compareById);
+
+    return snapshot;
+}
+
+/* Enumerate windows matching pattern (NULL for all) into a new snapshot */
+WindowSnapshot *WindowSnapshotCreate(char *pattern) {
+    SnapshotBuilder builder;
+    CF_SCOPED CFArrayRef windowList = CopyWindowList();
+
+    memset(&builder, 0, sizeof(builder));
+    EnumerateWindowListUTF8(windowList, pattern, AddWindow, (void *)&builder);
+
+    return finishSnapshot(&builder);
+}
+
+/* Snapshot of copies of count windows, in the given order; title may be
+ * NULL in any of them, to be made from appName and windowName
+ */
+WindowSnapshot *WindowSnapshotCreateFromWindows(
+    const WindowInfo *windows,
+    int count
+) {
+    SnapshotBuilder builder;
+    char *title;
+    int i;
+
+    memset(&builder, 0, sizeof(builder));
+    for(i = 0; i < count; i++) {
+        title = windows[i].title ? NULL :
+            windowTitle((char *)windows[i].appName,
+                        (char *)windows[i].windowName);
+        addWindowInfo(
+            &builder, windows[i].id, windows[i].pid, windows[i].layer,
+            windows[i].bounds, windows[i].appName, windows[i].windowName,
+            title ? title : windows[i].title
+        );
+        free(title);
+    }
+
+    return finishSnapshot(&builder);
+}
+
+/* Take a reference to a snapshot */
+WindowSnapshot *WindowSnapshotRetain(WindowSnapshot *snapshot) {
+    if(snapshot) {
+        atomic_fetch_add_explicit(&snapshot->refCount, 1, memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+/* Drop a reference to a snapshot, freeing it on the last release */
+void WindowSnapshotRelease(WindowSnapshot *snapshot) {
+    if(!snapshot) return;
+    if(atomic_fetch_sub_explicit(
+           &snapshot->refCount, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    free(snapshot->byId);
+    free(snapshot->strings);
+    free(snapshot->windows);
+    free(snapshot);
+}
+
+/* Number of windows in snapshot */
+int WindowSnapshotGetCount(const WindowSnapshot *snapshot) {
+    return snapshot ? snapshot->count : 0;
+}
+
+/* Window by index in front to back order (NULL if out of range) */
+const WindowInfo *WindowSnapshotGetWindow(
+    const WindowSnapshot *snapshot,
+    int index
+) {
+    if(!snapshot || index < 0 || index >= snapshot->count) return NULL;
+    return &snapshot->windows[index];
+}
+
+/* Find window by ID (NULL if not present), O(log n) */
+const WindowInfo *WindowSnapshotFindWindow(
+    const WindowSnapshot *snapshot,
+    CGWindowID id
+) {
+    int lo, hi, mid;
+
+    if(!snapshot) return NULL;
+    lo = 0;
+    hi = snapshot->count - 1;
+    while(lo <= hi) {
+        mid = lo + (hi - lo) / 2;
+        if(snapshot->byId[mid].id == id) {
+            return &snapshot->windows[snapshot->byId[mid].index];
+        }
+        if(snapshot->byId[mid].id < id) lo = mid + 1; else hi = mid - 1;
+    }
+    return NULL;
+}
+
+/* Initialize an empty slot */
+void WindowSnapshotSlotInit(WindowSnapshotSlot *slot) {
+    atomic_init(&slot->current, NULL);
+    atomic_init(&slot->epoch, 0);
+    atomic_init(&slot->readers[0], 0);
+    atomic_init(&slot->readers[1], 0);
+    pthread_mutex_init(&slot->publishLock, NULL);
+}
+
+/* Release current snapshot and destroy slot; no readers may remain */
+void WindowSnapshotSlotDestroy(WindowSnapshotSlot *slot) {
+    WindowSnapshotRelease(atomic_exchange(&slot->current, NULL));
+    pthread_mutex_destroy(&slot->publishLock);
+}
+
+/* Return retained current snapshot (NULL if none), caller must release.
+ * The reader announces itself on the current epoch's counter before it
+ * loads the pointer, so a publisher cannot free the snapshot between the
+ * load and the retain. If the epoch flipped while announcing, retry on
+ * the new epoch, which will see the newly published pointer.
+ */
+WindowSnapshot *WindowSnapshotSlotAcquire(WindowSnapshotSlot *slot) {
+    WindowSnapshot *snapshot;
+    unsigned int e;
+
+    while(1) {
+        e = atomic_load(&slot->epoch) & 1;
+        atomic_fetch_add(&slot->readers[e], 1);
+        if((atomic_load(&slot->epoch) & 1) == e) break;
+        atomic_fetch_sub(&slot->readers[e], 1);
+    }
+    snapshot = WindowSnapshotRetain(atomic_load(&slot->current));
+    atomic_fetch_sub(&slot->readers[e], 1);
+
+    return snapshot;
+}
+
+/* Replace current snapshot, taking ownership of caller's reference */
+void WindowSnapshotSlotPublish(
+    WindowSnapshotSlot *slot,
+    WindowSnapshot *snapshot
+) {
+    WindowSnapshot *old;
+    unsigned int e;
+
+    pthread_mutex_lock(&slot->publishLock);
+    old = atomic_exchange(&slot->current, snapshot);
+
+    /* Flip epoch, then wait out readers that announced on the old one */
+    e = atomic_fetch_add(&slot->epoch, 1) & 1;
+    while(atomic_load(&slot->readers[e]) != 0) sched_yield();
+    pthread_mutex_unlock(&slot->publishLock);
+
+    WindowSnapshotRelease(old);
+}
+
+
+/* ======================================================================== */
@@ -0,0 +1,121 @@
+/* ========================================================================
+ * winsnapshot.h - immutable, reference counted snapshots of the window list
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINSNAPSHOT_H
+#define WINSNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "winutils.h"
+
+/* One window as seen by a single enumeration; strings are owned by snapshot */
+typedef struct {
+    CGWindowID id;            /* kCGWindowNumber */
+    pid_t pid;                /* kCGWindowOwnerPID */
+    int layer;                /* kCGWindowLayer */
+    CGRect bounds;            /* kCGWindowBounds */
+    const char *appName;      /* kCGWindowOwnerName */
+    const char *windowName;   /* kCGWindowName */
+    const char *title;        /* "appName - windowName" */
+} WindowInfo;
+
+/* Opaque, immutable after creation, safe to read from any number of threads */
+typedef struct WindowSnapshot WindowSnapshot;
+
+/* Enumerate windows matching pattern (NULL for all) into a new snapshot */
+WindowSnapshot *WindowSnapshotCreate(char *pattern);
+
+/* Snapshot of copies of count windows, without asking the window server;
+ * a NULL title is made from appName and windowName
+ */
+WindowSnapshot *WindowSnapshotCreateFromWindows(
+    const WindowInfo *windows,
+    int count
+);
+
+/* Take or drop a reference; the last release frees the snapshot */
+WindowSnapshot *WindowSnapshotRetain(WindowSnapshot *snapshot);
+void WindowSnapshotRelease(WindowSnapshot *snapshot);
+
+/* Number of windows, and window by index in front to back order */
+int WindowSnapshotGetCount(const WindowSnapshot *snapshot);
+const WindowInfo *WindowSnapshotGetWindow(
+    const WindowSnapshot *snapshot,
+    int index
+);
+
+/* Find window by ID (NULL if not present), O(log n) */
+const WindowInfo *WindowSnapshotFindWindow(
+    const WindowSnapshot *snapshot,
+    CGWindowID id
+);
+
+/* Holds the most recently published snapshot for concurrent readers.
+ * Readers never block; a publisher swaps in a new snapshot, waits for
+ * readers that may still be picking up the old one, then releases it.
+ */
+typedef struct {
+    _Atomic(WindowSnapshot *) current;
+    atomic_uint epoch;
+    atomic_int readers[2];
+    pthread_mutex_t publishLock;
+} WindowSnapshotSlot;
+
+/* Initialize an empty slot, or release its snapshot and destroy it */
+void WindowSnapshotSlotInit(WindowSnapshotSlot *slot);
+void WindowSnapshotSlotDestroy(WindowSnapshotSlot *slot);
+
+/* Return retained current snapshot (NULL if none), caller must release */
+WindowSnapshot *WindowSnapshotSlotAcquire(WindowSnapshotSlot *slot);
+
+/* Replace current snapshot, taking ownership of caller's reference */
+void WindowSnapshotSlotPublish(
+    WindowSnapshotSlot *slot,
+    WindowSnapshot *snapshot
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINSNAPSHOT_H */
+
+
+/* ======================================================================== */
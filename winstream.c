@@ -0,0 +1,252 @@
+/* ========================================================================
+ * winstream.c - enumerate any number of windows in fixed-size chunks
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include "winstream.h"
+#include "winutf8.h"
+
+/* Everything one chunk needs, reused for the next; the string buffers
+ * stop growing once they fit the longest chunk of names seen so far
+ */
+typedef struct {
+    WindowInfo windows[WINSTREAM_CHUNK];
+    CFStringRef strings[2 * WINSTREAM_CHUNK];
+    char *names[2 * WINSTREAM_CHUNK];
+    UTF8Buffers utf8;
+    char *titles;
+    size_t titlesCapacity;
+} ChunkBuffers;
+
+/* Every window on every space, on screen or not, at any layer */
+void WinStreamFilterInit(WinStreamFilter *filter) {
+    filter->options = kCGWindowListOptionAll;
+    filter->relativeTo = kCGNullWindowID;
+    filter->minLayer = INT_MIN;
+    filter->maxLayer = INT_MAX;
+}
+
+/* Set filter options from a list like "onscreen,nodesktop", see
+ * winstream.h
+ */
+int WinStreamFilterParseOptions(WinStreamFilter *filter, const char *list) {
+    static const struct {
+        const char *name;
+        CGWindowListOption option;
+        int needsWindow;
+    } names[] = {
+        { "all", kCGWindowListOptionAll, 0 },
+        { "onscreen", kCGWindowListOptionOnScreenOnly, 0 },
+        { "above", kCGWindowListOptionOnScreenAboveWindow, 1 },
+        { "below", kCGWindowListOptionOnScreenBelowWindow, 1 },
+        { "including", kCGWindowListOptionIncludingWindow, 1 },
+        { "nodesktop", kCGWindowListExcludeDesktopElements, 0 }
+    };
+    CGWindowListOption options = kCGWindowListOptionAll;
+    CGWindowID relativeTo = kCGNullWindowID;
+    const char *p = list, *value;
+    char *end;
+    size_t len, i;
+    long id;
+
+    do {
+        len = strcspn(p, ",=");
+        for(i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if(strlen(names[i].name) == len &&
+               strncmp(names[i].name, p, len) == 0)
+            {
+                break;
+            }
+        }
+        if(i == sizeof(names) / sizeof(names[0])) return -1;
+        p += len;
+
+        /* Options relative to a window all have to name the same one */
+        if(names[i].needsWindow) {
+            if(*p != '=') return -1;
+            value = p + 1;
+            id = strtol(value, &end, 10);
+            if(end == value || id <= 0 || (*end && *end != ',')) return -1;
+            if(relativeTo != kCGNullWindowID && relativeTo != id) return -1;
+            relativeTo = (CGWindowID)id;
+            p = end;
+        } else if(*p == '=') {
+            return -1;
+        }
+        options |= names[i].option;
+    } while(*p++ == ',');
+
+    filter->options = options;
+    filter->relativeTo = relativeTo;
+    return 0;
+}
+
+/* Describe numIds windows, keep those in the layer range, and run
+ * callback on them; set stop if it asks to, return number of windows
+ * kept, or -1 on error
+ */
+static int streamChunk(
+    const WinStreamFilter *filter,
+    const void **ids,
+    CFIndex numIds,
+    ChunkBuffers *buffers,
+    int(*callback)(const WindowInfo *windows, int count, void *callback_data),
+    void *callback_data,
+    int *stop
+) {
+    CF_SCOPED CFArrayRef chunkIds = CFArrayCreate(NULL, ids, numIds, NULL);
+    CF_SCOPED CFArrayRef descriptions = NULL;
+    CFDictionaryRef window;
+    WindowInfo *info;
+    char *appName, *windowName, *title;
+    size_t titlesLen;
+    CFIndex i;
+    int count, layer;
+
+    if(chunkIds) {
+        descriptions = CGWindowListCreateDescriptionFromArray(chunkIds);
+    }
+    if(!descriptions) return -1;
+
+    /* Keep windows in the layer range, noting names to convert */
+    count = 0;
+    for(i = 0; i < CFArrayGetCount(descriptions) && count < WINSTREAM_CHUNK;
+        i++)
+    {
+        window = CFArrayGetValueAtIndex(descriptions, i);
+        layer = CFDictionaryGetInt(window, kCGWindowLayer);
+        if(layer < filter->minLayer || layer > filter->maxLayer) continue;
+        info = &buffers->windows[count];
+        info->id = CFDictionaryGetInt(window, kCGWindowNumber);
+        info->pid = CFDictionaryGetInt(window, kCGWindowOwnerPID);
+        info->layer = layer;
+        info->bounds.origin = CGWindowGetPosition(window);
+        info->bounds.size = CGWindowGetSize(window);
+        buffers->strings[2 * count] =
+            CFDictionaryGetValue(window, kCGWindowOwnerName);
+        buffers->strings[2 * count + 1] =
+            CFDictionaryGetValue(window, kCGWindowName);
+        count++;
+    }
+    if(count == 0) return 0;
+
+    /* Convert the chunk's names in one batch, then build titles like
+     * windowTitle() does, both into buffers kept from earlier chunks
+     */
+    if(CFStringsConvertUTF8(
+           buffers->strings, 2 * count, buffers->names, &buffers->utf8))
+    {
+        return -1;
+    }
+    titlesLen = 0;
+    for(i = 0; i < count; i++) {
+        appName = buffers->names[2 * i];
+        windowName = buffers->names[2 * i + 1];
+        titlesLen += (appName ? strlen(appName) : 0) + strlen(" - ") +
+            (windowName ? strlen(windowName) : 0) + 1;
+    }
+    if(titlesLen > buffers->titlesCapacity) {
+        title = (char *)realloc(buffers->titles, titlesLen);
+        if(!title) return -1;
+        buffers->titles = title;
+        buffers->titlesCapacity = titlesLen;
+    }
+    title = buffers->titles;
+    for(i = 0; i < count; i++) {
+        info = &buffers->windows[i];
+        appName = buffers->names[2 * i];
+        windowName = buffers->names[2 * i + 1];
+        info->appName = appName ? appName : "";
+        info->windowName = windowName ? windowName : "";
+        info->title = title;
+        if(!*info->appName) {
+            *title = '\0';
+        } else if(!*info->windowName) {
+            strcpy(title, info->appName);
+        } else {
+            sprintf(title, "%s - %s", info->appName, info->windowName);
+        }
+        title += strlen(title) + 1;
+    }
+
+    if(callback && (*callback)(buffers->windows, count, callback_data)) {
+        *stop = 1;
+    }
+    return count;
+}
+
+/* Run callback on chunks of windows filter selects, see winstream.h */
+int WinStreamWindows(
+    const WinStreamFilter *filter,
+    int(*callback)(const WindowInfo *windows, int count, void *callback_data),
+    void *callback_data
+) {
+    CF_SCOPED CFArrayRef windowIds = NULL;
+    const void *ids[WINSTREAM_CHUNK];
+    ChunkBuffers *buffers;
+    CFIndex numIds, start, len;
+    int visited, kept, stop;
+
+    /* Window IDs alone are small, so list them all up front; the much
+     * larger descriptions are only made a chunk at a time
+     */
+    windowIds = CGWindowListCreate(filter->options, filter->relativeTo);
+    if(!windowIds) return -1;
+    buffers = (ChunkBuffers *)calloc(1, sizeof(ChunkBuffers));
+    if(!buffers) return -1;
+
+    numIds = CFArrayGetCount(windowIds);
+    visited = stop = 0;
+    for(start = 0; start < numIds && !stop; start += WINSTREAM_CHUNK) {
+        len = numIds - start;
+        if(len > WINSTREAM_CHUNK) len = WINSTREAM_CHUNK;
+        CFArrayGetValues(windowIds, CFRangeMake(start, len), ids);
+        kept = streamChunk(
+            filter, ids, len, buffers, callback, callback_data, &stop
+        );
+        if(kept == -1) {
+            visited = -1;
+            break;
+        }
+        visited += kept;
+    }
+
+    UTF8BuffersFree(&buffers->utf8);
+    free(buffers->titles);
+    free(buffers);
+    return visited;
+}
+
+
+/* ======================================================================== */
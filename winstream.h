@@ -0,0 +1,90 @@
+/* ========================================================================
+ * winstream.h - enumerate any number of windows in fixed-size chunks
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINSTREAM_H
+#define WINSTREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <limits.h>
+#include "winsnapshot.h"
+
+/* Most windows handed to the callback at once */
+#define WINSTREAM_CHUNK 256
+
+/* Which windows WinStreamWindows() visits */
+typedef struct {
+    CGWindowListOption options;   /* as for CGWindowListCopyWindowInfo() */
+    CGWindowID relativeTo;        /* window options are relative to */
+    int minLayer, maxLayer;       /* kCGWindowLayer range, inclusive */
+} WinStreamFilter;
+
+/* Set filter to every window on every space, on screen or not, at any
+ * layer; EnumerateWindows() instead uses on screen only, excluding
+ * desktop elements, and layers up to 0
+ */
+void WinStreamFilterInit(WinStreamFilter *filter);
+
+/* Set filter options and relativeTo from a comma separated list of
+ * "all", "onscreen", "above=id", "below=id", "including=id", and
+ * "nodesktop", each adding the matching kCGWindowListOption; return 0,
+ * or -1 if the list is malformed or names two different windows
+ */
+int WinStreamFilterParseOptions(WinStreamFilter *filter, const char *list);
+
+/* Run callback on the windows filter selects, front to back, in chunks
+ * of at most WINSTREAM_CHUNK. Only one chunk of window descriptions is
+ * held at a time and its buffers are reused, so memory does not grow
+ * with the number of windows; windows and their strings are valid only
+ * during the callback. The callback returns nonzero to stop early.
+ * Return number of windows visited, or -1 on error.
+ */
+int WinStreamWindows(
+    const WinStreamFilter *filter,
+    int(*callback)(const WindowInfo *windows, int count, void *callback_data),
+    void *callback_data
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINSTREAM_H */
+
+
+/* ======================================================================== */
@@ -0,0 +1,457 @@
+/* ========================================================================
+ * winutf8.c - bulk conversion of CFStrings to UTF-8
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#if !defined(WINUTF8_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#elif !defined(WINUTF8_SCALAR) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "winutf8.h"
+
+/* Batches with fewer strings than this per thread are not split; starting
+ * a thread costs about as much as converting a few thousand titles
+ */
+#define MIN_STRINGS_PER_THREAD 4096
+
+/* Strings of up to this many UTF-16 units are copied out on the stack */
+#define STACK_UNITS 256
+
+/* ASCII units copied one at a time before looking for a longer run */
+#define ASCII_SCALAR_UNITS 8
+
+/* Strings ahead of the one being converted to start fetching; with the
+ * whole list to go through, there is no need to wait on each in turn
+ */
+#define PREFETCH_AHEAD 8
+
+/* Bytes per string to make room for up front, enough for most titles */
+#define EXPECTED_STRING_SIZE 32
+
+/* Contiguous run of a batch handled by one thread, converted into its own
+ * buffer: the batch's output for the first range, a spare one for the
+ * others, which are appended to the first once every range is done. As
+ * buffers can move while they grow, cstrings[i] holds 1 + the offset of
+ * string i in its range's buffer until then.
+ */
+typedef struct {
+    const CFStringRef *strings;
+    char **cstrings;
+    size_t from, to;
+    char **output;
+    size_t *capacity;
+    size_t length;            /* bytes of output used */
+    int failed;               /* out of memory */
+} BatchRange;
+
+/* Return length of the leading run of ASCII units in src[0, len); most
+ * window titles are entirely ASCII, so check a vector at a time
+ */
+static size_t asciiPrefix(const UniChar *src, size_t len) {
+    size_t i = 0;
+
+#if !defined(WINUTF8_SCALAR) && defined(__SSE2__)
+    __m128i high = _mm_set1_epi16((short)0xFF80);
+    __m128i zero = _mm_setzero_si128();
+    for(; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(v, high), zero);
+        if(_mm_movemask_epi8(ascii) != 0xFFFF) break;
+    }
+#elif !defined(WINUTF8_SCALAR) && defined(__ARM_NEON)
+    uint16x8_t high = vdupq_n_u16(0xFF80);
+    for(; i + 8 <= len; i += 8) {
+        uint16x8_t v = vld1q_u16((const uint16_t *)(src + i));
+        if(vmaxvq_u16(vandq_u16(v, high))) break;
+    }
+#endif
+    while(i < len && src[i] < 0x80) i++;
+    return i;
+}
+
+/* Narrow len ASCII units into as many bytes */
+static void narrowASCII(const UniChar *src, size_t len, char *dst) {
+    size_t i = 0;
+
+#if !defined(WINUTF8_SCALAR) && defined(__SSE2__)
+    for(; i + 16 <= len; i += 16) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + i + 8));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#elif !defined(WINUTF8_SCALAR) && defined(__ARM_NEON)
+    for(; i + 8 <= len; i += 8) {
+        uint16x8_t v = vld1q_u16((const uint16_t *)(src + i));
+        vst1_u8((uint8_t *)(dst + i), vmovn_u16(v));
+    }
+#endif
+    for(; i < len; i++) dst[i] = (char)src[i];
+}
+
+/* True if src[i] starts a valid surrogate pair */
+static inline int isSurrogatePair(const UniChar *src, size_t len, size_t i) {
+    return src[i] >= 0xD800 && src[i] < 0xDC00 &&
+        i + 1 < len && src[i + 1] >= 0xDC00 && src[i + 1] < 0xE000;
+}
+
+/* Exact UTF-8 size of len UTF-16 units */
+size_t UTF16GetUTF8Length(const UniChar *src, size_t len) {
+    size_t size = 0, i = 0, run;
+
+    while(i < len) {
+        if(src[i] < 0x80) {
+            run = asciiPrefix(src + i, len - i);
+            size += run;
+            i += run;
+            continue;
+        }
+        if(src[i] < 0x800) {
+            size += 2;
+        } else if(isSurrogatePair(src, len, i)) {
+            size += 4;
+            i++;
+        } else {
+            size += 3;
+        }
+        i++;
+    }
+
+    return size;
+}
+
+/* Convert len UTF-16 units into dst, return number of bytes written. Each
+ * run of units of one size is converted by its own loop, as titles tend
+ * to stay in one script for a while; ASCII runs go a vector at a time only
+ * once they outlast the spaces and punctuation between words of others.
+ */
+size_t UTF16ToUTF8(const UniChar *src, size_t len, char *dst) {
+    unsigned char *out = (unsigned char *)dst;
+    size_t i = 0, end, run;
+    unsigned int c;
+
+    while(i < len) {
+        c = src[i];
+        if(c < 0x80) {
+            end = i + ASCII_SCALAR_UNITS < len ? i + ASCII_SCALAR_UNITS : len;
+            do {
+                *out++ = c;
+            } while(++i < end && (c = src[i]) < 0x80);
+            if(i == end && i < len && src[i] < 0x80) {
+                run = asciiPrefix(src + i, len - i);
+                narrowASCII(src + i, run, (char *)out);
+                out += run;
+                i += run;
+            }
+        } else if(c < 0x800) {
+            do {
+                *out++ = 0xC0 | (c >> 6);
+                *out++ = 0x80 | (c & 0x3F);
+            } while(++i < len && (c = src[i]) >= 0x80 && c < 0x800);
+        } else if((c & 0xF800) != 0xD800) {
+            do {
+                *out++ = 0xE0 | (c >> 12);
+                *out++ = 0x80 | ((c >> 6) & 0x3F);
+                *out++ = 0x80 | (c & 0x3F);
+            } while(++i < len && (c = src[i]) >= 0x800 &&
+                    (c & 0xF800) != 0xD800);
+        } else if(isSurrogatePair(src, len, i)) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (src[i + 1] - 0xDC00);
+            *out++ = 0xF0 | (c >> 18);
+            *out++ = 0x80 | ((c >> 12) & 0x3F);
+            *out++ = 0x80 | ((c >> 6) & 0x3F);
+            *out++ = 0x80 | (c & 0x3F);
+            i += 2;
+        } else {
+            *out++ = 0xEF;    /* U+FFFD for an unpaired surrogate */
+            *out++ = 0xBF;
+            *out++ = 0xBD;
+            i++;
+        }
+    }
+
+    return out - (unsigned char *)dst;
+}
+
+/* Return buffer of *capacity bytes grown to at least size bytes (itself
+ * if already big enough), or NULL if out of memory, leaving it as it was;
+ * capacity at least doubles, so growing a string at a time is cheap
+ */
+static void *growBuffer(void *buffer, size_t *capacity, size_t size) {
+    if(buffer && size <= *capacity) return buffer;
+    if(size < 2 * *capacity) size = 2 * *capacity;
+    buffer = realloc(buffer, size);
+    if(buffer) *capacity = size;
+    return buffer;
+}
+
+/* Convert a range of strings into its buffer, one string start to finish
+ * at a time, so each is read only once: most of the cost of a large batch
+ * is fetching strings that are no longer in cache
+ */
+static void *convertRange(void *rangePtr) {
+    BatchRange *range = (BatchRange *)rangePtr;
+    UniChar stackChars[STACK_UNITS], *copied;
+    const UniChar *chars;
+    const char *bytes;
+    CFStringRef string;
+    size_t i, length, size;
+    char *output;
+
+    output = (char *)growBuffer(
+        *range->output, range->capacity,
+        (range->to - range->from) * EXPECTED_STRING_SIZE + 1
+    );
+    if(output) *range->output = output;
+    for(i = range->from; output && i < range->to; i++) {
+        if(i + PREFETCH_AHEAD < range->to) {
+            __builtin_prefetch(range->strings[i + PREFETCH_AHEAD]);
+        }
+        string = range->strings[i];
+        if(!string) {
+            range->cstrings[i] = NULL;
+            continue;
+        }
+
+        /* Take the ASCII fast path where CF allows it; otherwise UTF-8
+         * needs at most 3 bytes per UTF-16 unit
+         */
+        bytes = CFStringGetCStringPtr(string, kCFStringEncodingUTF8);
+        length = bytes ? strlen(bytes) : (size_t)CFStringGetLength(string);
+        output = (char *)growBuffer(
+            output, range->capacity,
+            range->length + (bytes ? length : 3 * length) + 1
+        );
+        if(!output) break;
+        *range->output = output;
+        if(bytes) {
+            memcpy(output + range->length, bytes, length);
+            size = length;
+        } else {
+            chars = CFStringGetCharactersPtr(string);
+            copied = NULL;
+            if(!chars) {
+                copied = length <= STACK_UNITS ? stackChars :
+                    (UniChar *)malloc(length * sizeof(UniChar));
+                if(!copied) break;
+                CFStringGetCharacters(string, CFRangeMake(0, length), copied);
+                chars = copied;
+            }
+            size = UTF16ToUTF8(chars, length, output + range->length);
+            if(copied != stackChars) free(copied);
+        }
+        output[range->length + size] = '\0';
+        range->cstrings[i] = (char *)(uintptr_t)(range->length + 1);
+        range->length += size + 1;
+    }
+    range->failed = !output || i < range->to;
+
+    return NULL;
+}
+
+/* Run pass over every range, the first on this thread and the rest on
+ * their own; if a thread cannot be started, run its range here instead
+ */
+static void runRanges(void *(*pass)(void *), BatchRange *ranges, int n) {
+    pthread_t threads[WINUTF8_MAX_THREADS];
+    int started[WINUTF8_MAX_THREADS];
+    int i;
+
+    for(i = 1; i < n; i++) {
+        started[i] =
+            pthread_create(&threads[i], NULL, pass, (void *)&ranges[i]) == 0;
+    }
+    (*pass)((void *)&ranges[0]);
+    for(i = 1; i < n; i++) {
+        if(started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            (*pass)((void *)&ranges[i]);
+        }
+    }
+}
+
+/* Free memory kept by CFStringsConvertUTF8(), see winutf8.h */
+void UTF8BuffersFree(UTF8Buffers *buffers) {
+    int i;
+
+    free(buffers->output);
+    for(i = 0; i < WINUTF8_MAX_THREADS - 1; i++) free(buffers->spare[i]);
+    memset(buffers, 0, sizeof(UTF8Buffers));
+}
+
+/* Convert count strings to UTF-8 in one buffer, see winutf8.h; only the
+ * buffer handed back is allocated unless the batch is split over threads
+ */
+char *CFStringsCopyUTF8(
+    const CFStringRef *strings,
+    size_t count,
+    char **cstrings
+) {
+    UTF8Buffers buffers;
+    char *output;
+
+    memset(&buffers, 0, sizeof(buffers));
+    if(CFStringsConvertUTF8(strings, count, cstrings, &buffers)) {
+        UTF8BuffersFree(&buffers);
+        return NULL;
+    }
+    output = buffers.output;
+    buffers.output = NULL;
+    UTF8BuffersFree(&buffers);
+    return output;
+}
+
+/* Convert count strings to UTF-8 in reused buffers, see winutf8.h */
+int CFStringsConvertUTF8(
+    const CFStringRef *strings,
+    size_t count,
+    char **cstrings,
+    UTF8Buffers *buffers
+) {
+    BatchRange ranges[WINUTF8_MAX_THREADS];
+    size_t i, share, outputLen;
+    char *output;
+    long cpus;
+    int numRanges, r, failed;
+
+    /* Split batch into ranges of equally many strings, one per thread;
+     * counting CPUs can take a system call, so only for a large batch
+     */
+    numRanges = count / MIN_STRINGS_PER_THREAD;
+    if(numRanges > 1) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if(numRanges > cpus) numRanges = cpus;
+    }
+    if(numRanges > WINUTF8_MAX_THREADS) numRanges = WINUTF8_MAX_THREADS;
+    if(numRanges < 1) numRanges = 1;
+    share = count / numRanges;
+    for(r = 0; r < numRanges; r++) {
+        ranges[r].strings = strings;
+        ranges[r].cstrings = cstrings;
+        ranges[r].from = r * share;
+        ranges[r].to = r == numRanges - 1 ? count : (r + 1) * share;
+        ranges[r].output = r ? &buffers->spare[r - 1] : &buffers->output;
+        ranges[r].capacity =
+            r ? &buffers->spareCapacity[r - 1] : &buffers->outputCapacity;
+        ranges[r].length = 0;
+    }
+    runRanges(convertRange, ranges, numRanges);
+
+    /* Append the other ranges to the first, and make offsets pointers */
+    failed = 0;
+    for(outputLen = 0, r = 0; r < numRanges; r++) {
+        failed |= ranges[r].failed;
+        outputLen += ranges[r].length;
+    }
+    output = failed ? NULL : (char *)growBuffer(
+        buffers->output, &buffers->outputCapacity, outputLen + 1
+    );
+    if(!output) return -1;
+    buffers->output = output;
+    for(outputLen = 0, r = 0; r < numRanges; r++) {
+        if(r) memcpy(output + outputLen, buffers->spare[r - 1],
+                     ranges[r].length);
+        for(i = ranges[r].from; i < ranges[r].to; i++) {
+            if(cstrings[i]) {
+                cstrings[i] =
+                    output + outputLen + ((uintptr_t)cstrings[i] - 1);
+            }
+        }
+        outputLen += ranges[r].length;
+    }
+
+    return 0;
+}
+
+/* Convert owner and window names of a whole window list, see winutf8.h */
+char *WindowListCopyNames(CFArrayRef windowList, char **names) {
+    CFIndex count, i;
+    CFDictionaryRef window;
+    CFStringRef *strings;
+    char *buffer;
+
+    count = windowList ? CFArrayGetCount(windowList) : 0;
+    strings = (CFStringRef *)malloc((2 * count + 1) * sizeof(CFStringRef));
+    if(!strings) return NULL;
+    for(i = 0; i < count; i++) {
+        window = CFArrayGetValueAtIndex(windowList, i);
+        strings[2 * i] = CFDictionaryGetValue(window, kCGWindowOwnerName);
+        strings[2 * i + 1] = CFDictionaryGetValue(window, kCGWindowName);
+    }
+    buffer = CFStringsCopyUTF8(strings, 2 * count, names);
+    free(strings);
+
+    return buffer;
+}
+
+/* Search windowList with names converted in one batch, see winutf8.h */
+int EnumerateWindowListUTF8(
+    CFArrayRef windowList,
+    char *pattern,
+    void(*callback)(
+        CFDictionaryRef window,
+        char *appName,
+        char *windowName,
+        void *callback_data
+    ),
+    void *callback_data
+) {
+    char **names, *buffer;
+    int count;
+
+    if(!windowList) return 0;
+    names = (char **)malloc(
+        (2 * CFArrayGetCount(windowList) + 1) * sizeof(char *)
+    );
+    if(!names) return -1;
+    buffer = WindowListCopyNames(windowList, names);
+    if(!buffer) {
+        free(names);
+        return -1;
+    }
+    count = EnumerateWindowListNames(
+        windowList, names, pattern, callback, callback_data
+    );
+    free(buffer);
+    free(names);
+
+    return count;
+}
+
+
+/* ======================================================================== */
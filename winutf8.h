@@ -0,0 +1,122 @@
+/* ========================================================================
+ * winutf8.h - bulk conversion of CFStrings to UTF-8
+ * Andrew Ho (andrew@zeuscat.com)
+ *
+ * Copyright (c) 2014-2020, Andrew Ho.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the author nor the names of its contributors may
+ * be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ========================================================================
+ */
+
+#ifndef WINUTF8_H
+#define WINUTF8_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "winutils.h"
+
+/* Most threads a single conversion is split across */
+#define WINUTF8_MAX_THREADS 8
+
+/* Convert count strings (NULL entries allowed) to NUL terminated UTF-8,
+ * all in one newly allocated buffer which caller must free; cstrings[i]
+ * is set to point into it (NULL for NULL entries). Return NULL if out
+ * of memory. Large batches are converted by several threads.
+ */
+char *CFStringsCopyUTF8(
+    const CFStringRef *strings,
+    size_t count,
+    char **cstrings
+);
+
+/* Memory CFStringsConvertUTF8() keeps from one batch to the next, so
+ * that converting batch after batch allocates nothing once it has grown
+ * to fit the largest; zero it before the first batch, and release it
+ * with UTF8BuffersFree()
+ */
+typedef struct {
+    char *output;             /* the converted strings */
+    size_t outputCapacity;
+    char *spare[WINUTF8_MAX_THREADS - 1];  /* other threads' share of it */
+    size_t spareCapacity[WINUTF8_MAX_THREADS - 1];
+} UTF8Buffers;
+
+void UTF8BuffersFree(UTF8Buffers *buffers);
+
+/* Like CFStringsCopyUTF8(), but convert into buffers->output, growing
+ * buffers only if this batch does not fit; cstrings point into output,
+ * valid until the next batch. Return 0, or -1 if out of memory.
+ */
+int CFStringsConvertUTF8(
+    const CFStringRef *strings,
+    size_t count,
+    char **cstrings,
+    UTF8Buffers *buffers
+);
+
+/* Convert owner and window name of every window in windowList at once;
+ * names[2 * i] and names[2 * i + 1] are set as CFDictionaryCopyCString()
+ * would for kCGWindowOwnerName and kCGWindowName of window i, but point
+ * into the single returned buffer, which caller must free
+ */
+char *WindowListCopyNames(CFArrayRef windowList, char **names);
+
+/* Like EnumerateWindowListNames() in winutils.h, but convert the names
+ * of every window in one batch with WindowListCopyNames() first; return
+ * -1 if out of memory
+ */
+int EnumerateWindowListUTF8(
+    CFArrayRef windowList,
+    char *pattern,
+    void(*callback)(
+        CFDictionaryRef window,
+        char *appName,
+        char *windowName,
+        void *callback_data
+    ),
+    void *callback_data
+);
+
+/* Exact UTF-8 size of len UTF-16 units, and convert them into dst (which
+ * must be that big) returning bytes written; unpaired surrogates become
+ * U+FFFD
+ */
+size_t UTF16GetUTF8Length(const UniChar *src, size_t len);
+size_t UTF16ToUTF8(const UniChar *src, size_t len, char *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* !WINUTF8_H */
+
+
+/* ======================================================================== */
@@ -34,7 +34,11 @@
  * ========================================================================
  */
 
+#include <fcntl.h>
 #include <fnmatch.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
 #include "winutils.h"
 
 /* These hardcoded applications are allowed to windows with no name */
@@ -48,17 +52,83 @@ static int emptyWindowNameAllowed(char *appName) {
  */
 extern AXError _AXUIElementGetWindow(AXUIElementRef, CGWindowID *out);
 
+/* Release CF object held in variable at refPtr, if any; see CF_SCOPED */
+void WinReleaseCFRef(void *refPtr) {
+    CFTypeRef ref = *(CFTypeRef *)refPtr;
+    if(ref) CFRelease(ref);
+}
+
 /* Search windows for match (NULL for all), run function (NULL for none) */
 int EnumerateWindows(
     char *pattern,
     void(*callback)(CFDictionaryRef window, void *callback_data),
     void *callback_data
+) {
+    CF_SCOPED CFArrayRef windowList = CopyWindowList();
+    return EnumerateWindowList(windowList, pattern, callback, callback_data);
+}
+
+/* Copy list of windows that EnumerateWindows() would search */
+CFArrayRef CopyWindowList() {
+    return CGWindowListCopyWindowInfo(
+        (kCGWindowListOptionOnScreenOnly|kCGWindowListExcludeDesktopElements),
+        kCGNullWindowID
+    );
+}
+
+/* Window callback and its data, for EnumerateWindowList() to pass on */
+typedef struct {
+    void(*callback)(CFDictionaryRef window, void *callback_data);
+    void *callback_data;
+} WindowCallback;
+
+/* Callback for EnumerateWindowListNames() that drops the names */
+static void CallWithoutNames(
+    CFDictionaryRef window,
+    char *appName,
+    char *windowName,
+    void *windowCallbackPtr
+) {
+    WindowCallback *windowCallback = (WindowCallback *)windowCallbackPtr;
+    if(windowCallback->callback) {
+        (*windowCallback->callback)(window, windowCallback->callback_data);
+    }
+}
+
+/* Like EnumerateWindows(), but search a window list the caller owns */
+int EnumerateWindowList(
+    CFArrayRef windowList,
+    char *pattern,
+    void(*callback)(CFDictionaryRef window, void *callback_data),
+    void *callback_data
+) {
+    WindowCallback windowCallback = { callback, callback_data };
+    return EnumerateWindowListNames(
+        windowList, NULL, pattern, CallWithoutNames, (void *)&windowCallback
+    );
+}
+
+/* Like EnumerateWindowList(), but with names converted (NULL to convert
+ * window by window) and passed to callback
+ */
+int EnumerateWindowListNames(
+    CFArrayRef windowList,
+    char **names,
+    char *pattern,
+    void(*callback)(
+        CFDictionaryRef window,
+        char *appName,
+        char *windowName,
+        void *callback_data
+    ),
+    void *callback_data
 ) {
     int patternLen, subPatternLen, count, i, layer;
     char *subPattern, *starL, *starR, *appName, *windowName, *title;
-    CFArrayRef windowList;
     CFDictionaryRef window;
 
+    if(!windowList) return 0;
+
     /* Add asterisks to left/right of pattern, if they are not already there */
     if(pattern && *pattern) {
         patternLen = strlen(pattern);
@@ -72,10 +142,6 @@ int EnumerateWindows(
     }
 
     /* Iterate through list of all windows, run callback on pattern matches */
-    windowList = CGWindowListCopyWindowInfo(
-        (kCGWindowListOptionOnScreenOnly|kCGWindowListExcludeDesktopElements),
-        kCGNullWindowID
-    );
     count = 0;
     for(i = 0; i < CFArrayGetCount(windowList); i++) {
         window = CFArrayGetValueAtIndex(windowList, i);
@@ -86,25 +152,26 @@ int EnumerateWindows(
 
         /* Turn application name and title into string to match against */
         appName = windowName = title = NULL;
-        appName = CFDictionaryCopyCString(window, kCGWindowOwnerName);
+        appName = names ? names[2 * i] :
+            CFDictionaryCopyCString(window, kCGWindowOwnerName);
         if(!appName || !*appName) goto skip;
-        windowName = CFDictionaryCopyCString(window, kCGWindowName);
+        windowName = names ? names[2 * i + 1] :
+            CFDictionaryCopyCString(window, kCGWindowName);
         if(!windowName || (!*windowName && !emptyWindowNameAllowed(appName)))
             goto skip;
         title = windowTitle(appName, windowName);
 
         /* If no pattern, or pattern matches, run callback */
         if(!pattern || fnmatch(subPattern, title, 0) == 0) {
-            if(callback) (*callback)(window, callback_data);
+            if(callback) (*callback)(window, appName, windowName, callback_data);
             count++;
         }
 
       skip:
         if(title) free(title);
-        if(windowName) free(windowName);
-        if(appName) free(appName);
+        if(!names && windowName) free(windowName);
+        if(!names && appName) free(appName);
     }
-    CFRelease(windowList);
     if(subPattern != pattern) free(subPattern);
 
     return count;
@@ -145,8 +212,12 @@ char *CFDictionaryCopyCString(CFDictionaryRef dict, const void *key) {
     isSuccess = CFStringGetCString(
         dictValue, value, maxSize, kCFStringEncodingUTF8
     );
+    if(!isSuccess) {
+        free(value);
+        return NULL;
+    }
 
-    return isSuccess ? value : NULL;
+    return value;
 }
 
 /* Return newly allocated window title like "appName - windowName" */
@@ -192,11 +263,16 @@ bool isAuthorizedForScreenRecording() {
         /* OS X prior to Catalina does not require separate permissions */
         return 1;
     } else {
+#ifdef __BLOCKS__
         CGDisplayStreamFrameAvailableHandler handler =
             ^(CGDisplayStreamFrameStatus status,
               uint64_t display_time,
               IOSurfaceRef frame_surface,
               CGDisplayStreamUpdateRef updateRef) { return; };
+#else
+        /* compilers without blocks, such as the examples/mock build */
+        CGDisplayStreamFrameAvailableHandler handler = NULL;
+#endif
         CGDisplayStreamRef stream =
             CGDisplayStreamCreate(CGMainDisplayID(), 1, 1, 'BGRA', NULL, handler);
         if (stream == NULL) {
@@ -208,6 +284,84 @@ bool isAuthorizedForScreenRecording() {
     }
 }
 
+/* Fill in path of per-user file caching a positive screen recording probe */
+static void authCachePath(char *path, size_t size) {
+    const char *tmpdir = getenv("TMPDIR");
+    if(!tmpdir || !*tmpdir) tmpdir = "/tmp";
+    snprintf(
+        path, size, "%s/movewin-auth-%u", tmpdir, (unsigned int)getuid()
+    );
+}
+
+/* Return true if we are authorized to do screen recording. Only positive
+ * answers are cached, as the mtime of a per-user file, and only for ttl
+ * seconds ($MOVEWIN_AUTH_TTL overrides, 0 disables); if an operation then
+ * fails, call forgetAuthorizationCache() and probe again.
+ */
+bool isAuthorizedForScreenRecordingCached(int ttl) {
+    char path[1024], *envTtl;
+    struct stat st;
+    time_t now;
+    int fd;
+
+    envTtl = getenv("MOVEWIN_AUTH_TTL");
+    if(envTtl && *envTtl) ttl = atoi(envTtl);
+    if(ttl <= 0) return isAuthorizedForScreenRecording();
+
+    /* Trust our own recent, regular cache file, but nothing else */
+    authCachePath(path, sizeof(path));
+    now = time(NULL);
+    if(lstat(path, &st) == 0 && S_ISREG(st.st_mode) &&
+       st.st_uid == getuid() &&
+       st.st_mtime <= now && now - st.st_mtime < ttl)
+    {
+        return 1;
+    }
+
+    if(!isAuthorizedForScreenRecording()) return 0;
+    fd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_NOFOLLOW, 0600);
+    if(fd != -1) {
+        futimes(fd, NULL);
+        close(fd);
+    }
+
+    return 1;
+}
+
+/* Forget any cached screen recording authorization */
+void forgetAuthorizationCache() {
+    char path[1024];
+    authCachePath(path, sizeof(path));
+    unlink(path);
+}
+
+/* Return true if windowList (NULL to copy a fresh one) looks like screen
+ * recording is still authorized. Without permission, windows of other
+ * processes are listed without names, so only when some are listed and
+ * none has one is the cache forgotten and permission probed again; an
+ * operation that merely matched nothing costs no probe.
+ */
+bool recheckAuthorizedForScreenRecording(CFArrayRef windowList) {
+    CF_SCOPED CFArrayRef freshList = NULL;
+    CFDictionaryRef window;
+    pid_t pid = getpid();
+    int i, others = 0;
+
+    if(!windowList) windowList = freshList = CopyWindowList();
+    if(!windowList) return isAuthorizedForScreenRecording();
+
+    for(i = 0; i < CFArrayGetCount(windowList); i++) {
+        window = CFArrayGetValueAtIndex(windowList, i);
+        if(CFDictionaryGetInt(window, kCGWindowOwnerPID) == pid) continue;
+        if(CFDictionaryGetValue(window, kCGWindowName)) return 1;
+        others++;
+    }
+    if(others == 0) return 1;
+
+    forgetAuthorizationCache();
+    return isAuthorizedForScreenRecordingCached(AUTH_CACHE_TTL);
+}
+
 /* Return true if and only if we are authorized to call accessibility APIs */
 bool isAuthorizedForAccessibility() {
 #if MAC_OS_X_VERSION_MIN_REQUIRED < 1090
@@ -221,16 +375,35 @@ bool isAuthorizedForAccessibility() {
 /* Silence warning that address of _AXUIElementGetWindow is always true */
 #pragma GCC diagnostic ignored "-Waddress"
 
-/* Given window dictionary from CGWindowList, return accessibility object */
-AXUIElementRef AXWindowFromCGWindow(CFDictionaryRef window) {
+/* Return windows of application with given PID as accessibility objects
+ * (NULL on error); caller must CFRelease() the returned array
+ */
+CFArrayRef AXApplicationCopyWindows(pid_t pid) {
+    CF_SCOPED AXUIElementRef app = AXUIElementCreateApplication(pid);
+    CFArrayRef appWindowList = NULL;
+
+    AXUIElementCopyAttributeValue(
+        app, kAXWindowsAttribute, (CFTypeRef *)&appWindowList
+    );
+
+    return appWindowList;
+}
+
+/* Given window dictionary from CGWindowList and the window list of its
+ * application, return accessibility object owned by that list (not retained)
+ */
+AXUIElementRef AXWindowFromCGWindowInList(
+    CFDictionaryRef window,
+    CFArrayRef appWindowList
+) {
     CGWindowID targetWindowId, actualWindowId;
-    CFStringRef targetWindowName, actualWindowTitle;
+    CFStringRef targetWindowName;
     CGPoint targetPosition, actualPosition;
     CGSize targetSize, actualSize;
-    pid_t pid;
-    AXUIElementRef app, appWindow, foundAppWindow;
+    AXUIElementRef appWindow;
     int i;
-    CFArrayRef appWindowList;
+
+    if(!appWindowList) return NULL;
 
     /* Save the window ID, name, position, and size we are looking for */
     targetWindowId = CFDictionaryGetInt(window, kCGWindowNumber);
@@ -238,15 +411,7 @@ AXUIElementRef AXWindowFromCGWindow(CFDictionaryRef window) {
     targetPosition = CGWindowGetPosition(window);
     targetSize = CGWindowGetSize(window);
 
-    /* Load accessibility application from window PID */
-    pid = CFDictionaryGetInt(window, kCGWindowOwnerPID);
-    app = AXUIElementCreateApplication(pid);
-    AXUIElementCopyAttributeValue(
-        app, kAXWindowsAttribute, (CFTypeRef *)&appWindowList
-    );
-
     /* Search application windows to find a match */
-    foundAppWindow = NULL;
     for(i = 0; i < CFArrayGetCount(appWindowList); i++) {
         appWindow = CFArrayGetValueAtIndex(appWindowList, i);
 
@@ -254,8 +419,7 @@ AXUIElementRef AXWindowFromCGWindow(CFDictionaryRef window) {
         if(_AXUIElementGetWindow) {
             _AXUIElementGetWindow(appWindow, &actualWindowId);
             if(actualWindowId == targetWindowId) {
-                foundAppWindow = appWindow;
-                break;
+                return appWindow;
             } else {
                 continue;
             }
@@ -265,11 +429,12 @@ AXUIElementRef AXWindowFromCGWindow(CFDictionaryRef window) {
          */
         } else {
 
-            /* Window name must match */
+            /* Window name must match; title is released every iteration */
+            CF_SCOPED CFStringRef actualWindowTitle = NULL;
             AXUIElementCopyAttributeValue(
                 appWindow, kAXTitleAttribute, (CFTypeRef *)&actualWindowTitle
             );
-            if( !actualWindowTitle ||
+            if( !actualWindowTitle || !targetWindowName ||
                 CFStringCompare(targetWindowName, actualWindowTitle, 0) != 0 )
             {
                 continue;
@@ -281,12 +446,26 @@ AXUIElementRef AXWindowFromCGWindow(CFDictionaryRef window) {
             actualSize = AXWindowGetSize(appWindow);
             if(!CGSizeEqualToSize(targetSize, actualSize)) continue;
 
-            /* Found the first matching window, save it and break */
-            foundAppWindow = appWindow;
-            break;
+            /* Found the first matching window */
+            return appWindow;
         }
     }
-    CFRelease(app);
+
+    return NULL;
+}
+
+/* Given window dictionary from CGWindowList, return accessibility object;
+ * the returned object is retained, and the caller must CFRelease() it
+ */
+AXUIElementRef AXWindowFromCGWindow(CFDictionaryRef window) {
+    CF_SCOPED CFArrayRef appWindowList = AXApplicationCopyWindows(
+        CFDictionaryGetInt(window, kCGWindowOwnerPID)
+    );
+    AXUIElementRef foundAppWindow;
+
+    /* Keep found window alive past the window list that owns it */
+    foundAppWindow = AXWindowFromCGWindowInList(window, appWindowList);
+    if(foundAppWindow) CFRetain(foundAppWindow);
 
     return foundAppWindow;
 }
@@ -297,38 +476,37 @@ void AXWindowGetValue(
     CFStringRef attrName,
     void *valuePtr
 ) {
-    AXValueRef attrValue;
+    CF_SCOPED AXValueRef attrValue = NULL;
     AXUIElementCopyAttributeValue(window, attrName, (CFTypeRef *)&attrValue);
+    if(!attrValue) return;
     AXValueGetValue(attrValue, AXValueGetType(attrValue), valuePtr);
-    CFRelease(attrValue);
 }
 
 /* Get position of window via accessibility object */
 CGPoint AXWindowGetPosition(AXUIElementRef window) {
-    CGPoint position;
+    CGPoint position = { 0, 0 };
     AXWindowGetValue(window, kAXPositionAttribute, &position);
     return position;
 }
 
 /* Set position of window via accessibility object */
 void AXWindowSetPosition(AXUIElementRef window, CGPoint position) {
-    AXValueRef attrValue = AXValueCreate(kAXValueCGPointType, &position);
+    CF_SCOPED AXValueRef attrValue =
+        AXValueCreate(kAXValueCGPointType, &position);
     AXUIElementSetAttributeValue(window, kAXPositionAttribute, attrValue);
-    CFRelease(attrValue);
 }
 
 /* Get size of window via accessibility object */
 CGSize AXWindowGetSize(AXUIElementRef window) {
-    CGSize size;
+    CGSize size = { 0, 0 };
     AXWindowGetValue(window, kAXSizeAttribute, &size);
     return size;
 }
 
 /* Set size of window via accessibility object */
 void AXWindowSetSize(AXUIElementRef window, CGSize size) {
-    AXValueRef attrValue = AXValueCreate(kAXValueCGSizeType, &size);
+    CF_SCOPED AXValueRef attrValue = AXValueCreate(kAXValueCGSizeType, &size);
     AXUIElementSetAttributeValue(window, kAXSizeAttribute, attrValue);
-    CFRelease(attrValue);
 }
 
 
@@ -43,6 +43,14 @@ extern "C" {
 
 #include <Carbon/Carbon.h>
 
+/* Release CF object held in variable at refPtr, if any; see CF_SCOPED */
+void WinReleaseCFRef(void *refPtr);
+
+/* Declare a CF variable that is released when it goes out of scope;
+ * set it to NULL beforehand to hand the object on to a caller instead
+ */
+#define CF_SCOPED __attribute__((cleanup(WinReleaseCFRef)))
+
 /* Search windows for match (NULL for all), run function (NULL for none) */
 int EnumerateWindows(
     char *pattern,
@@ -50,6 +58,40 @@ int EnumerateWindows(
     void *callback_data
 );
 
+/* Copy list of windows that EnumerateWindows() would search;
+ * caller must CFRelease() the returned array
+ */
+CFArrayRef CopyWindowList();
+
+/* Like EnumerateWindows(), but search a window list the caller owns;
+ * window dictionaries passed to callback stay valid as long as the list
+ */
+int EnumerateWindowList(
+    CFArrayRef windowList,
+    char *pattern,
+    void(*callback)(CFDictionaryRef window, void *callback_data),
+    void *callback_data
+);
+
+/* Like EnumerateWindowList(), but also pass callback the owner and window
+ * name the window was matched by (valid only during the call); names[2 * i]
+ * and names[2 * i + 1] are those of window i if already converted, as by
+ * WindowListCopyNames() in winutf8.h, or names is NULL to convert each
+ * window's on the way, as EnumerateWindowList() does
+ */
+int EnumerateWindowListNames(
+    CFArrayRef windowList,
+    char **names,
+    char *pattern,
+    void(*callback)(
+        CFDictionaryRef window,
+        char *appName,
+        char *windowName,
+        void *callback_data
+    ),
+    void *callback_data
+);
+
 /* Fetch an integer value from a CFDictionary */
 int CFDictionaryGetInt(CFDictionaryRef dict, const void *key);
 
@@ -66,12 +108,44 @@ CGSize CGWindowGetSize(CFDictionaryRef window);
 /* Return true if and only if we are authorized to do screen recording */
 bool isAuthorizedForScreenRecording();
 
+/* Seconds a positive screen recording probe is trusted for by default */
+#define AUTH_CACHE_TTL 60
+
+/* Like isAuthorizedForScreenRecording(), but skip the probe if it already
+ * succeeded within ttl seconds ($MOVEWIN_AUTH_TTL overrides, 0 disables)
+ */
+bool isAuthorizedForScreenRecordingCached(int ttl);
+
+/* Forget any cached authorization, e.g. after an operation fails */
+void forgetAuthorizationCache();
+
+/* After an operation found nothing, return true if screen recording still
+ * looks authorized; probes again only if windowList (NULL to copy a fresh
+ * one) lists other processes' windows but none of their names
+ */
+bool recheckAuthorizedForScreenRecording(CFArrayRef windowList);
+
 /* Return true if and only if we are authorized to call accessibility APIs */
 bool isAuthorizedForAccessibility();
 
-/* Given window dictionary from CGWindowList, return accessibility object */
+/* Given window dictionary from CGWindowList, return accessibility object
+ * (NULL if not found); caller must CFRelease() the returned object
+ */
 AXUIElementRef AXWindowFromCGWindow(CFDictionaryRef window);
 
+/* Return windows of application with given PID as accessibility objects
+ * (NULL on error); caller must CFRelease() the returned array
+ */
+CFArrayRef AXApplicationCopyWindows(pid_t pid);
+
+/* Like AXWindowFromCGWindow(), but search an already copied application
+ * window list; the returned object is owned by that list, not retained
+ */
+AXUIElementRef AXWindowFromCGWindowInList(
+    CFDictionaryRef window,
+    CFArrayRef appWindowList
+);
+
 /* Get a value from an accessibility object */
 void AXWindowGetValue(
     AXUIElementRef window,